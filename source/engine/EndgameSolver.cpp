@@ -0,0 +1,188 @@
+#include "EndgameSolver.h"
+#include "other/Time.h"
+#include "tak/Result.h"
+
+#include <algorithm>
+#include <bit>
+#include <functional>
+
+static constexpr uint64_t optimisticSalt = 0x9e3779b97f4a7c15; // Keeps the two horizon scores apart in the table
+static constexpr uint64_t solveSalt = 0xbf58476d1ce4e5b9;      // Added each solve, it mustn't cancel the other out
+
+static int scoreResult(Result result, Player player)
+{
+    if (result == Result::Draw)
+        return 0;
+
+    bool blackWon = result & StoneBits::Black;
+    return blackWon == (player == Player::Black) ? 1 : -1;
+}
+
+EndgameSolver::EndgameSolver(std::size_t tableSize, std::size_t nodeBudget, int maxDepth)
+    : mTable(tableSize), mNodeBudget(nodeBudget), mMaxDepth(maxDepth)
+{
+}
+
+// The same as TinueSolver, we only read the clock every so often
+bool EndgameSolver::outOfBudget()
+{
+    if (mNodes >= mNodeBudget)
+        mOutOfBudget = true;
+
+    if (mStopSearchingTime && mNodes >= mNextClockCheck)
+    {
+        mNextClockCheck = mNodes + 256;
+        if (timeInMics() >= mStopSearchingTime)
+            mOutOfBudget = true;
+    }
+    return mOutOfBudget;
+}
+
+std::size_t EndgameSolver::countPlacementsLeft(const Position& position)
+{
+    auto flats = position.getReserveCount();
+    auto caps = position.getCapReserveCount();
+    std::size_t stonesLeft = std::min(flats.White + caps.White, flats.Black + caps.Black);
+    std::size_t emptySquares = std::popcount(position.getEmptyBitboard());
+    return std::min(stonesLeft, emptySquares);
+}
+
+// Could the player to move end the game with a placement, or by filling the board with a spread
+bool EndgameSolver::canEndOnFlats(const Position& position)
+{
+    Player player = position.getPlayer();
+    std::size_t stonesLeft = position.getReserveCount()[player] + position.getCapReserveCount()[player];
+    return stonesLeft <= 1 || static_cast<std::size_t>(std::popcount(position.getEmptyBitboard())) <= position.size();
+}
+
+int EndgameSolver::search(const Position& position, int depth, int alpha, int beta, int horizonScore, Move* rootMove)
+{
+    ++mNodes;
+
+    const Player player = position.getPlayer();
+    auto result = position.checkResult();
+    if (result != Result::None)
+        return scoreResult(result, player);
+
+    if (depth == 0 || outOfBudget())
+        return horizonScore;
+
+    // One ply from the horizon, only a move which ends the game can do better than the horizon score
+    // If we can't run out of stones or fill the board this move, that means a road
+    if (depth == 1 && !rootMove && !canEndOnFlats(position))
+        return position.hasRoadInOne(player) ? 1 : horizonScore;
+
+    const uint64_t hash = std::hash<Position>{}(position) ^ mSalt ^ (horizonScore > 0 ? optimisticSalt : 0);
+    Record& record = mTable[hash % mTable.size()];
+    Move tableMove;
+    if (record.mHash == hash)
+    {
+        tableMove = record.mMove;
+        if (record.mDepth >= depth && !rootMove)
+        {
+            if (record.mType == ResultType::Exact)
+                return record.mScore;
+            if (record.mType == ResultType::LowerBound)
+                alpha = std::max(alpha, static_cast<int>(record.mScore));
+            if (record.mType == ResultType::UpperBound)
+                beta = std::min(beta, static_cast<int>(record.mScore));
+            if (alpha >= beta)
+                return record.mScore;
+        }
+    }
+
+    // Flat races are decided by the flat count, so we try flat placements first, and walls last
+    auto moves = position.generateMoves();
+    auto moveOrder = [&](const Move& move) {
+        if (move == tableMove)
+            return 4;
+        if (move.mDirection != Direction::None)
+            return 1;
+        return move.mStoneType == StoneType::Flat ? 3 : move.mStoneType == StoneType::Cap ? 2 : 0;
+    };
+    std::stable_sort(moves.begin(), moves.end(),
+                     [&](const Move& lhs, const Move& rhs) { return moveOrder(lhs) > moveOrder(rhs); });
+
+    const int originalAlpha = alpha;
+    int bestScore = -2; // Worse than any loss, so we always have a best move
+    Move bestMove;
+    for (const auto& move : moves)
+    {
+        Position nextPosition(position);
+        nextPosition.play(move);
+        int score = -search(nextPosition, depth - 1, -beta, -alpha, -horizonScore);
+        if (score > bestScore)
+        {
+            bestScore = score;
+            bestMove = move;
+        }
+
+        alpha = std::max(alpha, score);
+        if (alpha >= beta)
+            break;
+    }
+
+    if (rootMove)
+        *rootMove = bestMove;
+
+    // Once we're out of nodes or time, scores are just the horizon score and not worth keeping
+    if (!mOutOfBudget)
+    {
+        auto type = bestScore <= originalAlpha ? ResultType::UpperBound
+                    : bestScore >= beta        ? ResultType::LowerBound
+                                               : ResultType::Exact;
+        record = {hash, bestMove, static_cast<int8_t>(bestScore), static_cast<uint8_t>(depth), type};
+    }
+
+    return bestScore;
+}
+
+EndgameResult EndgameSolver::solve(const Position& position, int64_t stopSearchingTime)
+{
+    mNodes = 0;
+    mStopSearchingTime = stopSearchingTime;
+    mOutOfBudget = false;
+    mNextClockCheck = 0;
+    mSalt += solveSalt;
+
+    EndgameResult endgame{EndgameStatus::Unknown, Move(), 0, 0};
+    if (position.checkResult() != Result::None)
+        return endgame;
+
+    int depth = 1;
+    for (; depth <= mMaxDepth && !mOutOfBudget; ++depth)
+    {
+        // Counting the horizon as a loss, anything we find is guaranteed
+        Move move;
+        int pessimistic = search(position, depth, -1, 1, -1, &move);
+        if (mOutOfBudget || !isSet(move))
+            break;
+
+        if (pessimistic == 1)
+        {
+            endgame = {EndgameStatus::Win, move, mNodes, depth};
+            break;
+        }
+
+        // Counting the horizon as a win, anything worse is guaranteed
+        int optimistic = search(position, depth, -1, 1, 1);
+        if (mOutOfBudget)
+            break;
+
+        if (optimistic == -1)
+        {
+            endgame = {EndgameStatus::Loss, Move(), mNodes, depth};
+            break;
+        }
+
+        if (pessimistic == 0 && optimistic == 0)
+        {
+            endgame = {EndgameStatus::Draw, move, mNodes, depth};
+            break;
+        }
+    }
+
+    endgame.mNodes = mNodes;
+    mLogger << LogLevel::Info << "Endgame search finished after " << mNodes << " nodes at depth " << depth << Flush;
+    return endgame;
+}
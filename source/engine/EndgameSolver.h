@@ -0,0 +1,67 @@
+#pragma once
+
+#include "TranspositionTable.h"
+#include "log/Logger.h"
+#include "tak/Move.h"
+#include "tak/Position.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum class EndgameStatus : uint8_t
+{
+    Unknown, // We ran out of nodes or depth before the result was exact
+    Win,
+    Draw,
+    Loss
+};
+
+struct EndgameResult
+{
+    EndgameStatus mStatus;
+    Move mMove;         // Only set for a win or a draw, a move which keeps that result
+    std::size_t mNodes; // How many positions did we search?
+    int mDepth;         // How many plies did we have to search to be sure?
+};
+
+// An exact solver for the end of a flat race, once one player is nearly out of stones or the board is nearly full
+// Positions only score a win (1), draw (0) or loss (-1) for the player to move. We search each depth twice, once
+// counting positions past the horizon as losses and once as wins, and the result is only exact when both agree
+class EndgameSolver
+{
+    struct Record
+    {
+        uint64_t mHash;
+        Move mMove;
+        int8_t mScore;
+        uint8_t mDepth;
+        ResultType mType;
+    };
+
+    Logger mLogger{"Endgame"};
+    std::vector<Record> mTable;
+    std::size_t mNodeBudget;
+    int mMaxDepth;
+    std::size_t mNodes{0};
+    int64_t mStopSearchingTime{0}; // Zero for no deadline
+    bool mOutOfBudget{false};
+    std::size_t mNextClockCheck{0};
+    uint64_t mSalt{0};             // XORed into every hash, so a solve misses older solves' records without clearing
+
+    bool outOfBudget();
+    // With rootMove we're at the root and need its best move, so we skip the shortcuts which return without one
+    int search(const Position& position, int depth, int alpha, int beta, int horizonScore, Move* rootMove = nullptr);
+
+public:
+    static constexpr std::size_t sDefaultTableSize = 1 << 18; // 256 thousand entries * 24 bytes = 6 Megs
+
+    explicit EndgameSolver(std::size_t tableSize = sDefaultTableSize, std::size_t nodeBudget = 50000,
+                           int maxDepth = 12);
+
+    // How many more placements before the game has to end, one player runs out of stones or the board fills
+    static std::size_t countPlacementsLeft(const Position& position);
+    static bool canEndOnFlats(const Position& position); // By the player to move placing, or filling the board
+
+    EndgameResult solve(const Position& position, int64_t stopSearchingTime = 0);
+};
@@ -1,64 +1,164 @@
 #include "Engine.h"
+#include "MonteCarlo.h"
 #include "other/Time.h"
 #include "tak/Position.h"
 
 #include <algorithm>
+#include <fstream>
+#include <limits>
 #include <optional>
+#include <random>
 
 static constexpr int winValue = 10000;
 static constexpr int infinity = 100001; // Not really infinity, but pretty high
 
-EvaluationWeights gDefaultEvaluationWeights = EvaluationWeights{8, 12, 9, 1, 1, 1, 4};
+static constexpr int nullMoveReduction = 2;
+static constexpr int lateMoveReduction = 1;
+static constexpr int lateMoveMinDepth = 3;
+static constexpr std::size_t lateMoveMinIndex = 4; // Leave the given move, top move and a couple of others alone
+static constexpr int quiescenceMaxPly = 4;
+static constexpr int quiescenceWinValue = winValue - 1 - quiescenceMaxPly; // Roads found past the horizon score less
+
+// Nothing has been tuned for a particular size yet, so every size starts from the same weights
+// The stack terms came from tune on games/TiltakVsTakoSize6.ptn, which says captives are more liability than asset
+static constexpr SizeEvaluationWeights defaultEvaluationWeights = []
+{
+    SizeEvaluationWeights weights{};
+    weights.fill(EvaluationWeights{8, 12, 9, 1, 1, 1, 4, 3, -1, -3, 0});
+    return weights;
+}();
+
+SizeEvaluationWeights gEvaluationWeights = defaultEvaluationWeights;
 
 int evaluate(const Position& position)
+{
+    return evaluateWithWeights(position, gEvaluationWeights[position.size()]);
+}
+
+int evaluateWithWeights(const Position& position, const EvaluationWeights& weights)
 {
     // TODO: Pretty dubious but this part is still up in the air
-    EvaluationWeights mWeights = gDefaultEvaluationWeights;
     int score = 0;
 
     auto reserveCounts = position.getReserveCount();
-    score -= reserveCounts[Player::White] * mWeights.mFlatsOnBoardWeight;
-    score += reserveCounts[Player::Black] * mWeights.mFlatsOnBoardWeight;
+    score -= reserveCounts[Player::White] * weights.mFlatsOnBoardWeight;
+    score += reserveCounts[Player::Black] * weights.mFlatsOnBoardWeight;
+
+    // Position keeps these up to date as moves are played, so we don't have to look at every square
+    const auto& terms = position.getSquareTerms();
+    score += terms.mFlats * weights.mFlatCountWeight;               // We want a high flat count
+    score += terms.mCaps * weights.mCapsOnBoardWeight;              // Use our cap rather than walls if possible
+    score += terms.mStackControl * weights.mStackControlWeight;     // Wanna control stacks
+    score += terms.mNobleControl * weights.mStackControlNobleBonus; // Wanna control stacks especially with nobles
+    score -= terms.mEdgeStones * weights.mStoneOnEdgeWeight;        // Lose a point for a square on the edge
+    score += terms.mReserves * weights.mReservesWeight;             // Stones we can spread to gain flats
+    score += terms.mCaptives * weights.mCaptivesWeight;             // Theirs we hold, but free when we spread
+    score += terms.mHardCaptives * weights.mHardCaptivesWeight;     // Theirs buried too deep to free
+
+    // This is just a constant offset to all scores, and so completely pointless. Still..
+    score -= static_cast<int>(weights.mFlatCountWeight * position.getKomi()); // A positive komi is points for black
 
-    auto size = position.size();
-    for (std::size_t index = 0; index < size * size; ++index)
+    // TODO: check if this is too slow to be worth it
+    auto islandLengths = position.countIslands();
+    score += islandLengths[Player::White] * weights.mIslandLengthsWeight; // We want our pieces as connected as possible
+    score -= islandLengths[Player::Black] * weights.mIslandLengthsWeight;
+
+    // Fewer placements from a road is better, but tune doesn't find it worth its cost yet, so skip it while it's off
+    if (weights.mRoadDistanceWeight != 0)
     {
-        auto square = position[index];
-        auto topStone = square.mTopStone;
-        if (square.mTopStone == Stone::Blank)
-            continue;
+        auto roadDistances = position.countRoadDistances();
+        score += static_cast<int>(roadDistances[Player::Black]) * weights.mRoadDistanceWeight;
+        score -= static_cast<int>(roadDistances[Player::White]) * weights.mRoadDistanceWeight;
+    }
 
-        auto colour = topStone & StoneBits::Black ? -1 : 1;
+    return score;
+}
 
-        if (isFlat(square.mTopStone))
-            score += mWeights.mFlatCountWeight * colour; // We want a high flat count
+EvaluationFeatures evaluationFeatures(const Position& position)
+{
+    auto reserveCounts = position.getReserveCount();
+    const auto& terms = position.getSquareTerms();
+    auto islandLengths = position.countIslands();
+    auto roadDistances = position.countRoadDistances();
+
+    EvaluationFeatures features{};
+    features[0] = static_cast<float>(reserveCounts[Player::Black]) - static_cast<float>(reserveCounts[Player::White]);
+    features[1] = terms.mFlats - static_cast<float>(position.getKomi());
+    features[2] = terms.mCaps;
+    features[3] = terms.mStackControl;
+    features[4] = terms.mNobleControl;
+    features[5] = -terms.mEdgeStones;
+    features[6] = static_cast<float>(islandLengths[Player::White]) - static_cast<float>(islandLengths[Player::Black]);
+    features[7] = terms.mReserves;
+    features[8] = terms.mCaptives;
+    features[9] = terms.mHardCaptives;
+    features[10] = static_cast<float>(roadDistances[Player::Black]) - static_cast<float>(roadDistances[Player::White]);
+    return features;
+}
 
-        if (isCap(square.mTopStone))
-            score += mWeights.mCapsOnBoardWeight * colour; // We want to use our cap rather than walls if possible
+bool loadEvaluationWeights(const std::string& path, SizeEvaluationWeights& weights)
+{
+    Logger logger("Weights");
+    std::ifstream file(path);
+    if (!file)
+    {
+        logger << LogLevel::Error << "Couldn't open weights file " << path << Flush;
+        return false;
+    }
 
-        score += square.mCount * mWeights.mStackControlWeight * colour; // Wanna control stacks
-        if (topStone & StoneBits::Standing)
-            score += square.mCount * mWeights.mStackControlNobleBonus * colour; // Wanna control stacks especially with
+    SizeEvaluationWeights loaded = weights;
+    std::size_t firstSize = 3;
+    std::size_t lastSize = 8;
+    std::string name;
+    int value;
+    while (file >> name >> value)
+    {
+        if (name == "Size")
+        {
+            if (value < 3 || value > 8)
+            {
+                logger << LogLevel::Error << "No such size " << value << " in " << path << Flush;
+                return false;
+            }
+            firstSize = lastSize = value;
+            continue;
+        }
 
-        if ((index < size) || (index >= (size * size) - size) || (index % size == 0) || (index % size == size - 1))
-            score -= mWeights.mStoneOnEdgeWeight * colour; // Lose a point for a square on the edge
+        auto field = std::find_if(gEvaluationWeightFields.begin(), gEvaluationWeightFields.end(),
+                                  [&](const EvaluationWeightField& field) { return name == field.mName; });
+        if (field == gEvaluationWeightFields.end())
+        {
+            logger << LogLevel::Error << "Unknown weight " << name << " in " << path << Flush;
+            return false;
+        }
+        for (std::size_t size = firstSize; size <= lastSize; ++size)
+            loaded[size].*field->mWeight = value;
     }
 
-    // This is just a constant offset to all scores, and so completely pointless. Still..
-    score -= static_cast<int>(mWeights.mFlatCountWeight * position.getKomi()); // A positive komi is points for black
+    if (!file.eof())
+    {
+        logger << LogLevel::Error << "Couldn't read weights file " << path << Flush;
+        return false;
+    }
 
-    // TODO: check if this is too slow to be worth it
-    auto islandLengths = position.countIslands();
-    score +=
-        islandLengths[Player::White] * mWeights.mIslandLengthsWeight; // We want our pieces as connected as possible
-    score -= islandLengths[Player::Black] * mWeights.mIslandLengthsWeight;
+    weights = loaded;
+    logger << LogLevel::Info << "Loaded weights from " << path << Flush;
+    return true;
+}
 
-    return score;
+bool saveEvaluationWeights(const std::string& path, const EvaluationWeights& weights, std::size_t size)
+{
+    std::ofstream file(path);
+    if (size != 0)
+        file << "Size " << size << "\n";
+    for (const auto& field : gEvaluationWeightFields)
+        file << field.mName << " " << weights.*field.mWeight << "\n";
+    return static_cast<bool>(file);
 }
 
 EvaluationFunction gDefaultEvaluator = &evaluate;
 
-int Engine::evaluateResult(Result result)
+static int evaluateResult(Result result)
 {
     assert(result != Result::None);
     if (result == Result::Draw)
@@ -70,6 +170,22 @@ int Engine::evaluateResult(Result result)
     return winValue;
 }
 
+Engine::Engine(EngineOptions options)
+    : mEndgamePlacementsLeft(options.mEndgamePlacementsLeft), mOpeningBook(options.mOpeningBookPath),
+      mBookSelection(options.mBookSelection), mBookRandom(std::random_device{}()), mEvaluator(options.mEvaluator),
+      mTranspositionTable(options.mUseMonteCarlo ? 1 : TranspositionTable::sDefaultTableSize), // Unused by MonteCarlo
+      mEvaluationCache(options.mEvaluationCacheSize), mSearch(makeSearch(options))
+{
+    if (options.mUseTinueSolver)
+        mTinueSolver = std::make_unique<TinueSolver>(TinueSolver::sDefaultTableSize, options.mTinueNodeBudget);
+    if (options.mUseEndgameSolver)
+        mEndgameSolver = std::make_unique<EndgameSolver>();
+    if (options.mUseMonteCarlo)
+        mMonteCarlo = std::make_unique<MonteCarlo>(MonteCarlo::sDefaultMaxNodes, MonteCarloOptions(options));
+}
+
+Engine::~Engine() = default;
+
 // Returns a score from white's point of view
 int Engine::evaluate(const Position& position)
 {
@@ -80,6 +196,22 @@ int Engine::evaluate(const Position& position)
     return mEvaluator(position);
 }
 
+// The search's evaluations go through the cache, as the same position is often reached by more than one move order
+template <typename Evaluator, typename Features>
+int SearchCore<Evaluator, Features>::cachedEvaluate(const Position& position)
+{
+    ++mStats.mEvaluatedNodes;
+    if (auto score = mEvaluationCache.fetch(position))
+    {
+        ++mStats.mEvalCacheHits;
+        return *score;
+    }
+
+    int score = mEvaluator(position);
+    mEvaluationCache.store(position, score);
+    return score;
+}
+
 Move Engine::chooseMoveFirst(const Position& position)
 {
     assert(position.checkResult() == Result::None);
@@ -96,12 +228,29 @@ Move Engine::chooseMoveRandom(const Position& position)
     return *randomMove;
 }
 
-SearchResult Engine::negamax(const Position& position, Move givenMove, int depth, int alpha, int beta, int colour)
+// Tak has no zugzwang outside of flat races, so passing should never be better than our best move
+// unless the flat count is about to decide the game, or someone is one move from a road
+template <typename Evaluator, typename Features>
+bool SearchCore<Evaluator, Features>::nullMoveIsSafe(const Position& position) const
+{
+    if (position.isInOpeningSwap())
+        return false;
+
+    auto reserveCounts = position.getReserveCount();
+    if (std::min(reserveCounts.White, reserveCounts.Black) <= position.size())
+        return false;
+
+    return !position.hasRoadInOne(Player::White) && !position.hasRoadInOne(Player::Black);
+}
+
+template <typename Evaluator, typename Features>
+SearchResult SearchCore<Evaluator, Features>::negamax(const Position& position, Move givenMove, int depth, int alpha,
+                                                      int beta, int colour, bool allowNullMove)
 {
     ++mStats.mSeenNodes;
 
     auto originalAlpha = alpha;
-    if (mUseTranspositionTable)
+    if (mFeatures.mUseTranspositionTable)
     {
         auto record = mTranspositionTable.fetch(position, depth);
         if (record)
@@ -138,19 +287,36 @@ SearchResult Engine::negamax(const Position& position, Move givenMove, int depth
 
     if (depth == 0)
     {
-        ++mStats.mEvaluatedNodes;
+        if (mFeatures.mUseQuiescence)
+            return SearchResult(quiesce(position, alpha, beta, colour, 0));
 
-        int score = mEvaluator(position) * colour;
+        int score = cachedEvaluate(position) * colour;
         return SearchResult(score);
     }
 
+    if (mFeatures.mUseAlphaBeta && mFeatures.mUseNullMove && allowNullMove && depth > nullMoveReduction &&
+        nullMoveIsSafe(position))
+    {
+        Position nullPosition(position);
+        nullPosition.togglePlayer();
+
+        // We only care whether passing still beats beta, so we search with a null window
+        auto nullScore = negamax(nullPosition, Move(), depth - 1 - nullMoveReduction, beta * -1, (beta - 1) * -1,
+                                 colour * -1, false);
+        if (nullScore.mScore * -1 >= beta)
+        {
+            ++mStats.mNullMoveCutoffs;
+            return SearchResult(beta);
+        }
+    }
+
     Move bestMove = Move();
     int bestScore = -infinity;
     auto moves = position.generateMoves();
     auto topMoveIndex = mTopMoves.size() - depth;
     auto topMove = mTopMoves[topMoveIndex];
 
-    if (mUseMoveOrdering)
+    if (mFeatures.mUseMoveOrdering)
     {
         if (isSet(givenMove) || isSet(topMove))
         {
@@ -175,13 +341,35 @@ SearchResult Engine::negamax(const Position& position, Move givenMove, int depth
         }
     }
 
-    for (auto& move : moves)
+    // We won't reduce anything while we're under threat, or any move which makes a threat of our own
+    bool canReduce = mFeatures.mUseAlphaBeta && mFeatures.mUseLateMoveReductions && depth >= lateMoveMinDepth &&
+                     !position.hasRoadInOne(opponent(position.getPlayer()));
+
+    for (std::size_t moveIndex = 0; moveIndex < moves.size(); ++moveIndex)
     {
+        const auto& move = moves[moveIndex];
         Position nextPosition(position);
         nextPosition.play(move);
 
-        auto score = negamax(nextPosition, Move(), depth - 1, beta * -1, alpha * -1, colour * -1);
-        score.mScore *= -1;
+        bool searchFullDepth = true;
+        SearchResult score(0);
+        if (canReduce && moveIndex >= lateMoveMinIndex && !nextPosition.hasRoadInOne(position.getPlayer()))
+        {
+            ++mStats.mReducedSearches;
+            score = negamax(nextPosition, Move(), depth - 1 - lateMoveReduction, (alpha + 1) * -1, alpha * -1,
+                            colour * -1);
+            score.mScore *= -1;
+
+            searchFullDepth = score.mScore > alpha;
+            if (searchFullDepth)
+                ++mStats.mReSearches;
+        }
+
+        if (searchFullDepth)
+        {
+            score = negamax(nextPosition, Move(), depth - 1, beta * -1, alpha * -1, colour * -1);
+            score.mScore *= -1;
+        }
 
         if (score.mScore > bestScore)
         {
@@ -191,7 +379,7 @@ SearchResult Engine::negamax(const Position& position, Move givenMove, int depth
         }
 
         alpha = std::max(alpha, score.mScore);
-        if (mUseAlphaBeta)
+        if (mFeatures.mUseAlphaBeta)
         {
             if (alpha >= beta)
             {
@@ -201,7 +389,7 @@ SearchResult Engine::negamax(const Position& position, Move givenMove, int depth
         }
     }
 
-    if (mUseTranspositionTable)
+    if (mFeatures.mUseTranspositionTable)
     {
         auto resultType = bestScore <= originalAlpha ? ResultType::UpperBound : bestScore >= beta ? ResultType::LowerBound : ResultType::Exact;
         mTranspositionTable.store(position, bestMove, bestScore, depth, resultType);
@@ -210,7 +398,52 @@ SearchResult Engine::negamax(const Position& position, Move givenMove, int depth
     return {bestMove, bestScore};
 }
 
-Move Engine::deepeningSearch(const Position& position)
+// At the horizon we only keep searching forcing moves: we take a road if we have one,
+// and if our opponent has a road we look at every placement or spread which might block it
+// Roads found here score just below roads found in the main search, so we still prefer those
+template <typename Evaluator, typename Features>
+int SearchCore<Evaluator, Features>::quiesce(const Position& position, int alpha, int beta, int colour, int ply)
+{
+    ++mStats.mQuiescenceNodes;
+
+    if (ply > 0) // negamax has already checked the result of the position at the horizon
+    {
+        auto result = position.checkResult();
+        if (result != Result::None)
+        {
+            ++mStats.mTerminalNodes;
+            return evaluateResult(result) * colour;
+        }
+    }
+
+    Player player = position.getPlayer();
+    if (position.hasRoadInOne(player))
+        return winValue - 1 - ply;
+
+    int standPat = cachedEvaluate(position) * colour;
+
+    auto threats = position.findWinningMoves(opponent(player));
+    if (threats.empty() || ply >= quiescenceMaxPly)
+        return standPat;
+
+    int bestScore = -(winValue - 1 - ply);
+    for (const auto& move : position.generateBlocks(threats))
+    {
+        // If this doesn't block, the first thing quiesce will find is our opponent's road
+        Position nextPosition(position);
+        nextPosition.play(move);
+        int score = quiesce(nextPosition, beta * -1, alpha * -1, colour * -1, ply + 1) * -1;
+        bestScore = std::max(bestScore, score);
+        alpha = std::max(alpha, score);
+        if (mFeatures.mUseAlphaBeta && alpha >= beta)
+            break;
+    }
+
+    return bestScore;
+}
+
+template <typename Evaluator, typename Features>
+Move SearchCore<Evaluator, Features>::deepeningSearch(const Position& position, int maxDepth, int64_t stopSearchingTime)
 {
     int depth = 0;
     Move move = Move();
@@ -239,18 +472,17 @@ Move Engine::deepeningSearch(const Position& position)
         mLogger << LogLevel::Info << "Estimated next search duration: " << searchDuration * searchIncreaseFactor
                 << Flush;
 
-        if (searchStop + searchDuration * searchIncreaseFactor > mStopSearchingTime)
+        if (searchStop + searchDuration * searchIncreaseFactor > stopSearchingTime)
             break;
 
         // If we've already found a loss, then might as well stop searching
-        if (std::abs(searchResult.mScore) >= winValue)
+        if (std::abs(searchResult.mScore) >= quiescenceWinValue)
         {
-            mStopSearchingTime = timeInMics();
             mLogger << LogLevel::Info << "Stopping search after finding end of game at depth " << depth << Flush;
             break;
         }
 
-        if (depth >= mMaxDepth)
+        if (depth >= maxDepth)
         {
             break;
         }
@@ -259,6 +491,73 @@ Move Engine::deepeningSearch(const Position& position)
     return move;
 }
 
+template <typename Evaluator, typename Features>
+SearchResult SearchCore<Evaluator, Features>::searchToDepth(const Position& position, int depth)
+{
+    mTopMoves.assign(depth, Move());
+    return negamax(position, Move(), depth, -infinity, infinity, position.getPlayer() == Player::White ? 1 : -1);
+}
+
+// The default options get a search with the evaluator and switches compiled in, anything else checks them as it goes
+Engine::Search Engine::makeSearch(const EngineOptions& options)
+{
+    const SearchFeatures features{options.mUseAlphaBeta,          options.mUseMoveOrdering,
+                                  options.mUseTranspositionTable, options.mUseNullMove,
+                                  options.mUseLateMoveReductions, options.mUseQuiescence};
+
+    const bool defaultFeatures = features.mUseAlphaBeta == DefaultSearchFeatures::mUseAlphaBeta &&
+                                 features.mUseMoveOrdering == DefaultSearchFeatures::mUseMoveOrdering &&
+                                 features.mUseTranspositionTable == DefaultSearchFeatures::mUseTranspositionTable &&
+                                 features.mUseNullMove == DefaultSearchFeatures::mUseNullMove &&
+                                 features.mUseLateMoveReductions == DefaultSearchFeatures::mUseLateMoveReductions &&
+                                 features.mUseQuiescence == DefaultSearchFeatures::mUseQuiescence;
+
+    // Which size doesn't matter yet, chooseMove switches to the right one
+    if (defaultFeatures && options.mEvaluator == &::evaluate)
+    {
+        mSearchSize = 6;
+        return Search(std::in_place_type<SizedSearch<6>>, SizedEvaluator<6>(), DefaultSearchFeatures(),
+                      mTranspositionTable, mEvaluationCache, mStats);
+    }
+
+    return Search(std::in_place_type<ConfiguredSearch>, EvaluatorFunction{options.mEvaluator}, features,
+                  mTranspositionTable, mEvaluationCache, mStats);
+}
+
+void Engine::useSizedSearch(std::size_t size)
+{
+    auto emplace = [&]<std::size_t Size>()
+    {
+        mSearch.emplace<SizedSearch<Size>>(SizedEvaluator<Size>(), DefaultSearchFeatures(), mTranspositionTable,
+                                           mEvaluationCache, mStats);
+    };
+
+    switch (size)
+    {
+    case 3:
+        emplace.operator()<3>();
+        break;
+    case 4:
+        emplace.operator()<4>();
+        break;
+    case 5:
+        emplace.operator()<5>();
+        break;
+    case 6:
+        emplace.operator()<6>();
+        break;
+    case 7:
+        emplace.operator()<7>();
+        break;
+    case 8:
+        emplace.operator()<8>();
+        break;
+    default:
+        assert(false);
+    }
+    mSearchSize = size;
+}
+
 bool Engine::openingBookContains(const Position& position)
 {
     Shift canonicalShift = position.getCanonicalShift();
@@ -274,19 +573,67 @@ std::string Engine::chooseMove(const Position& position, double timeLimitSeconds
     Shift canonicalShift = position.getCanonicalShift();
     Position canonicalPosition = position.shift(canonicalShift);
     mLogger << LogLevel::Info << "Shift: " << canonicalShift << Flush;
-    if (mOpeningBook.contains(canonicalPosition))
+    if (const auto responses = mOpeningBook.getResponses(canonicalPosition); !responses.empty())
     {
-        auto openingMove = *chooseRandomElement(mOpeningBook.getResponses(canonicalPosition));
-        openingMove.mIndex = applyShift(openingMove.mIndex, canonicalPosition.size(), getReverseShift(canonicalShift));
-        mLogger << LogLevel::Info << "Playing move from opening book" << Flush;
-        return moveToPtn(openingMove, canonicalPosition.size());
+        auto openingMove = OpeningBook::select(responses, mBookSelection, mBookRandom).mMove;
+        openingMove = canonicalPosition.shiftMove(openingMove, getReverseShift(canonicalShift));
+
+        // The book only knows positions by their hash, so a collision could give us nonsense
+        auto moves = position.generateMoves();
+        if (std::find(moves.begin(), moves.end(), openingMove) != moves.end())
+        {
+            mLogger << LogLevel::Info << "Playing move from opening book" << Flush;
+            return moveToPtn(openingMove, canonicalPosition.size());
+        }
+        mLogger << LogLevel::Warn << "Opening book move isn't legal here, searching instead" << Flush;
     }
 
     timeLimitSeconds = std::max(0.001, timeLimitSeconds); // Need at least a millisecond
-    mStopSearchingTime = startTime + static_cast<int64_t>(timeLimitSeconds * micsInSecond);
-    mMaxDepth = maxDepth;
+    const auto timeLimitMics = static_cast<int64_t>(timeLimitSeconds * micsInSecond);
+    const auto stopSearchingTime = startTime + timeLimitMics;
+
+    if (mTinueSolver)
+    {
+        // Most positions have no tinue, so the solver only gets a tenth of our time and the search keeps the rest
+        auto tinue = mTinueSolver->solve(position, startTime + timeLimitMics / 10);
+        mStats.mTinueNodes += tinue.mNodes;
+        if (tinue.mStatus == TinueStatus::Tinue)
+        {
+            mLogger << LogLevel::Info << "Playing tinue found after " << tinue.mNodes << " nodes" << Flush;
+            return moveToPtn(tinue.mMove, position.size());
+        }
+    }
 
-    auto move = deepeningSearch(position);
+    // A proven loss is no use to us, the main search might still find something our opponent could get wrong
+    // Like the tinue solver, the endgame solver gets a tenth of our time, after whatever the tinue solver used
+    if (mEndgameSolver && EndgameSolver::countPlacementsLeft(position) <= mEndgamePlacementsLeft)
+    {
+        auto endgame = mEndgameSolver->solve(position, timeInMics() + timeLimitMics / 10);
+        mStats.mEndgameNodes += endgame.mNodes;
+        if (endgame.mStatus == EndgameStatus::Win || endgame.mStatus == EndgameStatus::Draw)
+        {
+            mLogger << LogLevel::Info << "Playing solved endgame found after " << endgame.mNodes << " nodes" << Flush;
+            return moveToPtn(endgame.mMove, position.size());
+        }
+    }
+
+    Move move;
+    if (mMonteCarlo)
+    {
+        // Playouts aren't counted in plies, so maxDepth doesn't apply
+        move = mMonteCarlo->search(position, std::numeric_limits<std::size_t>::max(), stopSearchingTime);
+        mStats.mPlayouts = mMonteCarlo->getPlayouts();
+        mStats.mTreeNodes = mMonteCarlo->getNodes().size();
+        mStats.mTreeMemory = mMonteCarlo->getMemoryUsage();
+    }
+    else
+    {
+        if (mSearchSize != 0 && mSearchSize != position.size())
+            useSizedSearch(position.size());
+
+        move = std::visit([&](auto& search) { return search.deepeningSearch(position, maxDepth, stopSearchingTime); },
+                          mSearch);
+    }
 
     auto stopTime = timeInMics();
     auto duration = stopTime - startTime;
@@ -295,6 +642,13 @@ std::string Engine::chooseMove(const Position& position, double timeLimitSeconds
     auto tableEntries = mTranspositionTable.count();
     mLogger << LogLevel::Info << "Table entries: " << tableEntries << Flush;
 
-    mStopSearchingTime = 0;
     return moveToPtn(move, position.size());
 }
+
+template class SearchCore<SizedEvaluator<3>, DefaultSearchFeatures>;
+template class SearchCore<SizedEvaluator<4>, DefaultSearchFeatures>;
+template class SearchCore<SizedEvaluator<5>, DefaultSearchFeatures>;
+template class SearchCore<SizedEvaluator<6>, DefaultSearchFeatures>;
+template class SearchCore<SizedEvaluator<7>, DefaultSearchFeatures>;
+template class SearchCore<SizedEvaluator<8>, DefaultSearchFeatures>;
+template class SearchCore<EvaluatorFunction, SearchFeatures>;
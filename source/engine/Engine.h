@@ -1,7 +1,10 @@
 #pragma once
 
 #include "../../external/robin_hood.h"
+#include "EndgameSolver.h"
+#include "EvaluationCache.h"
 #include "OpeningBook.h"
+#include "TinueSolver.h"
 #include "TranspositionTable.h"
 #include "log/Logger.h"
 #include "tak/Move.h"
@@ -9,28 +12,57 @@
 #include "tak/Result.h"
 #include "tak/RobinHoodHashes.h"
 
+#include <array>
+#include <memory>
 #include <string>
+#include <variant>
 #include <vector>
 
+class MonteCarlo;
+
 struct EngineStats
 {
-    std::size_t mSeenNodes;      // How many times did we call negamax?
-    std::size_t mEvaluatedNodes; // How many times did we call evaluate?
-    std::size_t mTerminalNodes;  // How many times did we see positions where the game was over?
-    std::size_t mTableHits;      // How many times did we see positions where the game was over?
-    EngineStats() : mSeenNodes(0), mEvaluatedNodes(0), mTerminalNodes(0), mTableHits(0)
+    std::size_t mSeenNodes;       // How many times did we call negamax?
+    std::size_t mEvaluatedNodes;  // How many times did we call evaluate?
+    std::size_t mEvalCacheHits;   // How many of those evaluations did the evaluation cache already have?
+    std::size_t mTerminalNodes;   // How many times did we see positions where the game was over?
+    std::size_t mTableHits;       // How many times did we see positions where the game was over?
+    std::size_t mNullMoveCutoffs; // How many times did passing still leave us above beta?
+    std::size_t mReducedSearches; // How many late moves did we search at reduced depth?
+    std::size_t mReSearches;      // How many of those reduced searches beat alpha and had to be searched again?
+    std::size_t mQuiescenceNodes; // How many times did we call quiesce?
+    std::size_t mTinueNodes;      // How many positions did the tinue solver expand?
+    std::size_t mEndgameNodes;    // How many positions did the endgame solver search?
+    std::size_t mPlayouts;        // How many playouts did the Monte Carlo search make?
+    std::size_t mTreeNodes;       // How many nodes were in its tree at the end, including any it reused?
+    std::size_t mTreeMemory;      // How many bytes did it allocate for the tree and its transpositions?
+    EngineStats()
+        : mSeenNodes(0), mEvaluatedNodes(0), mEvalCacheHits(0), mTerminalNodes(0), mTableHits(0), mNullMoveCutoffs(0),
+          mReducedSearches(0), mReSearches(0), mQuiescenceNodes(0), mTinueNodes(0), mEndgameNodes(0), mPlayouts(0),
+          mTreeNodes(0), mTreeMemory(0)
     {
     }
     void reset()
     {
-        mEvaluatedNodes = mTerminalNodes = mSeenNodes = mTableHits = 0;
+        mEvaluatedNodes = mEvalCacheHits = mTerminalNodes = mSeenNodes = mTableHits = 0;
+        mNullMoveCutoffs = mReducedSearches = mReSearches = mQuiescenceNodes = mTinueNodes = mEndgameNodes = 0;
+        mPlayouts = mTreeNodes = mTreeMemory = 0;
+    }
+    double evalCacheHitRate() const
+    {
+        return mEvaluatedNodes ? static_cast<double>(mEvalCacheHits) / mEvaluatedNodes : 0;
     }
 };
 
 inline std::ostream& operator<<(std::ostream& stream, EngineStats stats)
 {
-    stream << "Node counts: Seen(" << stats.mSeenNodes << "), Evaluated(" << stats.mEvaluatedNodes << "), Terminal("
-           << stats.mTerminalNodes << "), TableHits(" << stats.mTableHits << ")";
+    stream << "Node counts: Seen(" << stats.mSeenNodes << "), Evaluated(" << stats.mEvaluatedNodes
+           << "), EvalCacheHitRate(" << stats.evalCacheHitRate() << "), Terminal(" << stats.mTerminalNodes
+           << "), TableHits(" << stats.mTableHits << "), NullMoveCutoffs(" << stats.mNullMoveCutoffs << "), Reduced("
+           << stats.mReducedSearches << "), ReSearched(" << stats.mReSearches << "), Quiescence("
+           << stats.mQuiescenceNodes << "), Tinue(" << stats.mTinueNodes << "), Endgame(" << stats.mEndgameNodes
+           << "), Playouts(" << stats.mPlayouts << "), TreeNodes(" << stats.mTreeNodes << "), TreeMemory("
+           << stats.mTreeMemory << ")";
 
     return stream;
 }
@@ -39,19 +71,54 @@ inline std::ostream& operator<<(std::ostream& stream, EngineStats stats)
 using EvaluationFunction = int (*)(const Position&);
 extern EvaluationFunction gDefaultEvaluator;
 
+// How MonteCarlo values a position at the edge of its tree, trading playouts for how much each one tells us
+enum class LeafEvaluation : uint8_t
+{
+    Rollout,  // Random moves until the game ends, cheap but noisy, and Tak games can go on a long time
+    Evaluate, // mRolloutPlies random moves, then the evaluator's score squashed into a win probability
+    Negamax   // mRolloutPlies random moves, then a negamax to mLeafDepth squashed the same way
+};
+
 struct EngineOptions
 {
     bool mUseAlphaBeta;
     bool mUseMoveOrdering;
     bool mUseTranspositionTable;
+    bool mUseNullMove;                  // Only applies with alpha beta, as it relies on a beta cutoff
+    bool mUseLateMoveReductions;        // Only applies with alpha beta, as it relies on a null window search
+    bool mUseQuiescence;                // Look for roads and blocks past the horizon rather than evaluating now
+    bool mUseTinueSolver;               // Try to prove a forced road before searching at all
+    std::size_t mTinueNodeBudget;
+    bool mUseEndgameSolver;             // Try to solve the flat race outright once the game is nearly over
+    std::size_t mEndgamePlacementsLeft; // How near, see EndgameSolver::countPlacementsLeft
+    std::size_t mEvaluationCacheSize;   // Entries in the evaluation cache, zero turns it off
     int mMaxDepth;
     std::string mOpeningBookPath;
     EvaluationFunction mEvaluator;
+    bool mUseMonteCarlo;            // Search with MonteCarlo rather than negamax, which the options above are for
+    std::size_t mThreadCount;       // Only MonteCarlo uses more than one so far
+    LeafEvaluation mLeafEvaluation; // Only for MonteCarlo
+    std::size_t mRolloutPlies;
+    int mLeafDepth;
+    BookSelection mBookSelection;
 
     EngineOptions(bool useAlphaBeta = true, bool useMoveOrdering = true, bool useTranspositionTable = false,
-                  int maxDepth = 8, std::string openingBookPath = "", EvaluationFunction evaluator = gDefaultEvaluator)
+                  int maxDepth = 8, std::string openingBookPath = "", EvaluationFunction evaluator = gDefaultEvaluator,
+                  bool useNullMove = true, bool useLateMoveReductions = true, bool useQuiescence = true,
+                  bool useTinueSolver = true, std::size_t tinueNodeBudget = 20000, bool useEndgameSolver = true,
+                  std::size_t endgamePlacementsLeft = 3,
+                  std::size_t evaluationCacheSize = EvaluationCache::sDefaultTableSize,
+                  bool useMonteCarlo = false, std::size_t threadCount = 1,
+                  LeafEvaluation leafEvaluation = LeafEvaluation::Rollout, std::size_t rolloutPlies = 0,
+                  int leafDepth = 1, BookSelection bookSelection = BookSelection::Weighted)
         : mUseAlphaBeta(useAlphaBeta), mUseMoveOrdering(useMoveOrdering), mUseTranspositionTable(useTranspositionTable),
-          mMaxDepth(maxDepth), mOpeningBookPath(openingBookPath), mEvaluator(evaluator)
+          mUseNullMove(useNullMove), mUseLateMoveReductions(useLateMoveReductions), mUseQuiescence(useQuiescence),
+          mUseTinueSolver(useTinueSolver), mTinueNodeBudget(tinueNodeBudget),
+          mUseEndgameSolver(useEndgameSolver), mEndgamePlacementsLeft(endgamePlacementsLeft),
+          mEvaluationCacheSize(evaluationCacheSize), mMaxDepth(maxDepth),
+          mOpeningBookPath(openingBookPath), mEvaluator(evaluator), mUseMonteCarlo(useMonteCarlo),
+          mThreadCount(threadCount), mLeafEvaluation(leafEvaluation), mRolloutPlies(rolloutPlies),
+          mLeafDepth(leafDepth), mBookSelection(bookSelection)
     {
     }
 };
@@ -65,9 +132,47 @@ struct EvaluationWeights
     int mStackControlNobleBonus;
     int mStoneOnEdgeWeight;
     int mIslandLengthsWeight; // For more info look in Position::countIslands in Position.cpp
+    int mReservesWeight;      // The stack terms are described in SquareTerms.h
+    int mCaptivesWeight;
+    int mHardCaptivesWeight;
+    int mRoadDistanceWeight; // For each placement the other player is further from a road than us
+};
+
+// Indexed by board size, as 4s, 6s and 8s with its two caps play quite differently
+// gEvaluationWeights starts as the compiled in defaults, and tak -weights replaces them from a file
+using SizeEvaluationWeights = std::array<EvaluationWeights, 9>;
+extern SizeEvaluationWeights gEvaluationWeights;
+
+// Every weight with the name weight files use for it, so tune and the files can treat the weights as a vector
+struct EvaluationWeightField
+{
+    const char* mName;
+    int EvaluationWeights::*mWeight;
 };
 
-extern EvaluationWeights gDefaultEvaluationWeights;
+inline constexpr std::array<EvaluationWeightField, 11> gEvaluationWeightFields{{
+    {"FlatsOnBoard", &EvaluationWeights::mFlatsOnBoardWeight},
+    {"FlatCount", &EvaluationWeights::mFlatCountWeight},
+    {"CapsOnBoard", &EvaluationWeights::mCapsOnBoardWeight},
+    {"StackControl", &EvaluationWeights::mStackControlWeight},
+    {"StackControlNobleBonus", &EvaluationWeights::mStackControlNobleBonus},
+    {"StoneOnEdge", &EvaluationWeights::mStoneOnEdgeWeight},
+    {"IslandLengths", &EvaluationWeights::mIslandLengthsWeight},
+    {"Reserves", &EvaluationWeights::mReservesWeight},
+    {"Captives", &EvaluationWeights::mCaptivesWeight},
+    {"HardCaptives", &EvaluationWeights::mHardCaptivesWeight},
+    {"RoadDistance", &EvaluationWeights::mRoadDistanceWeight},
+}};
+
+// What evaluate multiplies each weight by, in the order of gEvaluationWeightFields
+// evaluate is the sum of these times the weights, give or take rounding a fractional komi
+using EvaluationFeatures = std::array<float, gEvaluationWeightFields.size()>;
+EvaluationFeatures evaluationFeatures(const Position& position);
+
+// Weight files have a "Name value" line per field, fields they leave out keep their current weight
+// Lines after a "Size n" line only apply to that size, those before any apply to every size
+bool loadEvaluationWeights(const std::string& path, SizeEvaluationWeights& weights);
+bool saveEvaluationWeights(const std::string& path, const EvaluationWeights& weights, std::size_t size = 0);
 
 struct SearchResult
 {
@@ -81,45 +186,130 @@ struct SearchResult
     }
 };
 
-// We want to fix estimating next ply duration before we use a transposition table
-// Plan: Engine takes an Evaluation function in its constructor
+int evaluate(const Position& position); // The handcrafted evaluation gDefaultEvaluator points to
+int evaluateWithWeights(const Position& position, const EvaluationWeights& weights); // The same, with any weights
+
+// Evaluator policies for SearchCore, the sized ones can be inlined into the search where a function pointer can't
+// and know their weights at compile time, rather than looking them up by the position's size every evaluation
+template <std::size_t Size> struct SizedEvaluator
+{
+    static_assert(Size >= 3 && Size <= 8);
+    int operator()(const Position& position) const
+    {
+        return evaluateWithWeights(position, gEvaluationWeights[Size]);
+    }
+};
+
+struct EvaluatorFunction
+{
+    EvaluationFunction mFunction;
+    int operator()(const Position& position) const
+    {
+        return mFunction(position);
+    }
+};
+
+// Feature policies for SearchCore, SearchFeatures are checked as the search runs, for tests and experiments
+struct SearchFeatures
+{
+    bool mUseAlphaBeta;
+    bool mUseMoveOrdering;
+    bool mUseTranspositionTable;
+    bool mUseNullMove;
+    bool mUseLateMoveReductions;
+    bool mUseQuiescence;
+};
+
+// The EngineOptions defaults, known at compile time so the compiler can drop the checks and the unused branches
+struct DefaultSearchFeatures
+{
+    static constexpr bool mUseAlphaBeta = true;
+    static constexpr bool mUseMoveOrdering = true;
+    static constexpr bool mUseTranspositionTable = false;
+    static constexpr bool mUseNullMove = true;
+    static constexpr bool mUseLateMoveReductions = true;
+    static constexpr bool mUseQuiescence = true;
+};
+
+// The search itself, instantiated in Engine.cpp for each pair of policies Engine can dispatch to
+// The tables and stats belong to Engine, so they outlive whichever search it picked
+template <typename Evaluator, typename Features> class SearchCore
+{
+    Logger mLogger{"Engine"};
+
+    const Evaluator mEvaluator;
+    const Features mFeatures;
+
+    TranspositionTable& mTranspositionTable;
+    EvaluationCache& mEvaluationCache;
+    EngineStats& mStats;
+
+    std::vector<Move> mTopMoves;
+
+    int cachedEvaluate(const Position& position);
+    bool nullMoveIsSafe(const Position& position) const;
+    int quiesce(const Position& position, int alpha, int beta, int colour, int ply);
+
+public:
+    SearchCore(Evaluator evaluator, Features features, TranspositionTable& transpositionTable,
+               EvaluationCache& evaluationCache, EngineStats& stats)
+        : mEvaluator(evaluator), mFeatures(features), mTranspositionTable(transpositionTable),
+          mEvaluationCache(evaluationCache), mStats(stats)
+    {
+    }
+
+    Move deepeningSearch(const Position& position, int maxDepth, int64_t stopSearchingTime);
+    SearchResult searchToDepth(const Position& position, int depth); // Straight there, the score is for who's to play
+    SearchResult negamax(const Position& position, Move givenMove, int depth, int alpha, int beta, int colour,
+                         bool allowNullMove = true);
+};
+
+// Picks the opening book, the solvers or a search, and dispatches the search to a SearchCore chosen by its options
+// With the default options that's a SizedSearch, which chooseMove swaps for the position's size if it has to
+// With mUseMonteCarlo it's a MonteCarlo instead, kept between moves so it can reuse its tree
 class Engine
 {
+    template <std::size_t Size> using SizedSearch = SearchCore<SizedEvaluator<Size>, DefaultSearchFeatures>;
+    using ConfiguredSearch = SearchCore<EvaluatorFunction, SearchFeatures>;
+    using Search = std::variant<SizedSearch<3>, SizedSearch<4>, SizedSearch<5>, SizedSearch<6>, SizedSearch<7>,
+                                SizedSearch<8>, ConfiguredSearch>;
+
     Logger mLogger{"Engine"};
 
-    const bool mUseAlphaBeta = true;
-    const bool mUseMoveOrdering = true;
-    const bool mUseTranspositionTable = true;
-    int mMaxDepth;
+    const std::size_t mEndgamePlacementsLeft;
 
     const OpeningBook mOpeningBook;
+    const BookSelection mBookSelection;
+    Xoshiro256 mBookRandom;
     const EvaluationFunction mEvaluator;
 
-    TranspositionTable mTranspositionTable{};
+    TranspositionTable mTranspositionTable;
+    std::unique_ptr<TinueSolver> mTinueSolver;     // Only with mUseTinueSolver, as its table is 6 Megs
+    std::unique_ptr<EndgameSolver> mEndgameSolver; // Only with mUseEndgameSolver, likewise
+    EvaluationCache mEvaluationCache;
     EngineStats mStats;
 
-    std::vector<Move> mTopMoves;
-    int64_t mStopSearchingTime{0};
+    std::size_t mSearchSize{0}; // The size mSearch is a SizedSearch for, or zero for a ConfiguredSearch
+    Search mSearch;             // Made after mSearchSize, as makeSearch sets it
+    std::unique_ptr<MonteCarlo> mMonteCarlo; // Only with mUseMonteCarlo
 
     Move chooseMoveFirst(const Position& position);
-    Move deepeningSearch(const Position& position);
-
-    int evaluateResult(Result result);
+    Search makeSearch(const EngineOptions& options);
+    void useSizedSearch(std::size_t size);
 
 public:
-    explicit Engine(EngineOptions options = EngineOptions())
-        : mUseAlphaBeta(options.mUseAlphaBeta), mUseMoveOrdering(options.mUseMoveOrdering),
-          mUseTranspositionTable(options.mUseTranspositionTable), mMaxDepth(options.mMaxDepth),
-          mOpeningBook(options.mOpeningBookPath), mEvaluator(options.mEvaluator)
-    {
-    }
+    explicit Engine(EngineOptions options = EngineOptions());
+    ~Engine(); // Where MonteCarlo is a complete type
+
+    // The search keeps references to our tables and stats
+    Engine(const Engine&) = delete;
+    Engine& operator=(const Engine&) = delete;
 
     std::string chooseMove(const Position& position, double timeLimitSeconds = 3, int maxDepth = 15);
     Move chooseMoveRandom(const Position& position);
 
     bool openingBookContains(const Position& position);
     int evaluate(const Position& position);
-    SearchResult negamax(const Position& position, Move givenMove, int depth, int alpha, int beta, int colour);
 
     const EngineStats& getStats()
     {
@@ -0,0 +1,29 @@
+#include "EvaluationCache.h"
+
+// Evaluations count komi, which the position hash leaves out, so an engine can't carry scores into another game
+uint64_t EvaluationCache::key(const Position& position)
+{
+    return hash_combine(std::hash<Position>{}(position), position.getKomi());
+}
+
+std::optional<int> EvaluationCache::fetch(const Position& position) const
+{
+    if (mTable.empty())
+        return std::nullopt;
+
+    auto hash = key(position);
+    const auto& record = mTable[hash % mTable.size()];
+    if (record.mHash == hash)
+        return record.mScore;
+
+    return std::nullopt;
+}
+
+void EvaluationCache::store(const Position& position, int score)
+{
+    if (mTable.empty())
+        return;
+
+    auto hash = key(position);
+    mTable[hash % mTable.size()] = {hash, score};
+}
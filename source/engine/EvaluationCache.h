@@ -0,0 +1,39 @@
+#pragma once
+
+#include "tak/Position.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// Static evaluations keyed by position hash, so a position reached by another move order isn't evaluated again
+// Direct mapped: a new position simply replaces whatever shared its slot
+class EvaluationCache
+{
+    struct Record
+    {
+        uint64_t mHash;
+        int mScore;
+    };
+
+    std::vector<Record> mTable;
+
+    static uint64_t key(const Position& position);
+
+public:
+    static constexpr std::size_t sDefaultTableSize = 1 << 16; // 65 thousand entries * 16 bytes = 1 Meg
+
+    // A table size of zero turns the cache off
+    explicit EvaluationCache(std::size_t tableSize = sDefaultTableSize) : mTable(tableSize)
+    {
+    }
+
+    std::optional<int> fetch(const Position& position) const;
+    void store(const Position& position, int score);
+
+    std::size_t getMemoryUsage() const
+    {
+        return mTable.size() * sizeof(Record);
+    }
+};
@@ -0,0 +1,567 @@
+#include "MonteCarlo.h"
+#include "other/Time.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <thread>
+
+// How good was this result for player, a win is 1 and a loss 0
+static float resultValue(Player player, Result result)
+{
+    if (result == Result::Draw || result == Result::None)
+        return 0.5f;
+
+    const bool blackWon = result & StoneBits::Black;
+    return blackWon == (player == Player::Black) ? 1.0f : 0.0f;
+}
+
+// Placing flats next to other stones, ours to build roads and theirs to block them, is usually where the game is
+// Spreads are rarer but matter, apart from moving a single stone onto an empty square, which rarely does anything
+float scoreMove(const Position& position, const Move& move)
+{
+    if (position.isInOpeningSwap())
+        return 1.0f;
+
+    const std::size_t size = position.size();
+    if (move.mDirection == Direction::None)
+    {
+        const Bitboard occupied = ~position.getEmptyBitboard() & gBoardMasks[size].mBoard;
+        const bool touching = adjacent(occupied, size) & (Bitboard{1} << move.mIndex);
+        float score = touching ? 2.0f : 0.0f;
+        if (move.mStoneType == StoneType::Flat)
+            score += 4.0f;
+        else if (move.mStoneType == StoneType::Cap)
+            score += 3.0f;
+        else
+            score += 1.0f;
+        return score;
+    }
+
+    if (move.mCount == 1 && position[move.mIndex + position.getOffset(move.mDirection)].mCount == 0)
+        return 0.5f;
+
+    return 2.0f;
+}
+
+// Root parallel trees split the nodes between them
+static std::size_t treeMaxNodes(std::size_t maxNodes, const MonteCarloOptions& options)
+{
+    if (options.mParallelism != MonteCarloParallelism::Root)
+        return maxNodes;
+
+    return maxNodes / std::max<std::size_t>(options.mThreadCount, 1);
+}
+
+MonteCarlo::MonteCarlo(std::size_t maxNodes, MonteCarloOptions options)
+    : mOptions(options), mMaxNodes(treeMaxNodes(maxNodes, options)), mNodes(new MonteCarloNode[mMaxNodes]),
+      mTranspositions(sTranspositionTableSize)
+{
+    if (options.mParallelism == MonteCarloParallelism::Root)
+    {
+        MonteCarloOptions treeOptions = options;
+        treeOptions.mThreadCount = 1;
+        treeOptions.mParallelism = MonteCarloParallelism::Tree;
+        for (std::size_t thread = 1; thread < options.mThreadCount; ++thread)
+            mRootTrees.push_back(std::make_unique<MonteCarlo>(mMaxNodes, treeOptions));
+    }
+
+    if (options.mLeafEvaluation == LeafEvaluation::Negamax)
+    {
+        for (std::size_t thread = 0; thread < searchThreadCount(); ++thread)
+            mLeafSearches.push_back(std::make_unique<LeafSearch>(options.mEvaluator));
+    }
+}
+
+// Appends a child for each move, or leaves the node as it was if the arena can't fit them all
+bool MonteCarlo::expand(uint32_t index, const Position& position, const MoveBuffer& moves)
+{
+    std::size_t firstChild = mNodeCount.load(std::memory_order_relaxed);
+    do
+    {
+        if (moves.empty() || firstChild + moves.size() > mMaxNodes)
+            return false;
+    } while (!mNodeCount.compare_exchange_weak(firstChild, firstChild + moves.size(), std::memory_order_relaxed));
+
+    float totalScore = 0.0f;
+    for (std::size_t move = 0; move < moves.size(); ++move)
+    {
+        // Only PUCT uses the priors, so the others can skip scoring the moves
+        const float score =
+            mOptions.mSelection == MonteCarloSelection::Puct ? scoreMove(position, moves[move]) : 1.0f;
+        totalScore += score;
+        mNodes[firstChild + move] = {moves[move], index, sNoNode, 0, 0.0f, score, 0, MonteCarloNode::State::Leaf,
+                                     Result::None};
+    }
+
+    for (std::size_t child = firstChild; child < firstChild + moves.size(); ++child)
+        mNodes[child].mPrior /= totalScore;
+
+    // Other threads only read the children once they see the node expanded
+    auto& node = mNodes[index];
+    node.mFirstChild = static_cast<uint32_t>(firstChild);
+    node.mChildCount = static_cast<uint16_t>(moves.size());
+    std::atomic_ref(node.mState).store(MonteCarloNode::State::Expanded, std::memory_order_release);
+    return true;
+}
+
+// If we've already expanded this position elsewhere in the tree, point at the children we made then
+bool MonteCarlo::expandLeaf(uint32_t index, const Position& position)
+{
+    auto& node = mNodes[index];
+    auto state = MonteCarloNode::State::Leaf;
+    if (!std::atomic_ref(node.mState).compare_exchange_strong(state, MonteCarloNode::State::Expanding,
+                                                              std::memory_order_acq_rel))
+        return false; // Another thread got here first
+
+    const auto hash = std::hash<Position>{}(position);
+    auto& record = mTranspositions[hash % mTranspositions.size()];
+    const auto transpositionIndex = std::atomic_ref(record.mNode).load(std::memory_order_relaxed);
+    const auto hashXorNode = std::atomic_ref(record.mHashXorNode).load(std::memory_order_relaxed);
+    if (transpositionIndex != sNoNode && (hashXorNode ^ transpositionIndex) == hash)
+    {
+        const auto& transposition = mNodes[transpositionIndex];
+        if (std::atomic_ref(transposition.mState).load(std::memory_order_acquire) == MonteCarloNode::State::Expanded)
+        {
+            node.mFirstChild = transposition.mFirstChild;
+            node.mChildCount = transposition.mChildCount;
+            std::atomic_ref(node.mState).store(MonteCarloNode::State::Expanded, std::memory_order_release);
+            return true;
+        }
+    }
+
+    if (!expand(index, position, position.generateMoves()))
+    {
+        std::atomic_ref(node.mState).store(MonteCarloNode::State::Leaf, std::memory_order_release);
+        return false;
+    }
+
+    std::atomic_ref(record.mNode).store(index, std::memory_order_relaxed);
+    std::atomic_ref(record.mHashXorNode).store(hash ^ index, std::memory_order_relaxed);
+    return true;
+}
+
+// Each child's win rate is for the player choosing between them, so we always want the highest
+uint32_t MonteCarlo::selectChild(const MonteCarloNode& node, Worker& worker) const
+{
+    if (mOptions.mSelection == MonteCarloSelection::Random)
+        return node.mFirstChild + worker.mRandom.below(node.mChildCount);
+
+    const bool useUct = mOptions.mSelection == MonteCarloSelection::Uct;
+    const auto nodePlays = std::atomic_ref(node.mPlayCount).load(std::memory_order_relaxed);
+    const float parentPlays = static_cast<float>(std::max<uint32_t>(nodePlays, 1));
+    const float exploration =
+        mOptions.mExploration * (useUct ? std::sqrt(std::log(parentPlays)) : std::sqrt(parentPlays));
+
+    uint32_t bestChild = node.mFirstChild;
+    float bestScore = -1.0f;
+    for (uint32_t index = node.mFirstChild; index < node.mFirstChild + node.mChildCount; ++index)
+    {
+        auto& child = mNodes[index];
+        const auto plays = std::atomic_ref(child.mPlayCount).load(std::memory_order_relaxed);
+        const float value = std::atomic_ref(child.mValue).load(std::memory_order_relaxed);
+        float score;
+        if (useUct)
+        {
+            if (plays == 0)
+                return index;
+            score = value / static_cast<float>(plays) + exploration / std::sqrt(static_cast<float>(plays));
+        }
+        else
+        {
+            // Children we haven't tried yet count as even until we know better
+            const float winRate = plays ? value / static_cast<float>(plays) : 0.5f;
+            score = winRate + exploration * child.mPrior / static_cast<float>(1 + plays);
+        }
+
+        if (score > bestScore)
+        {
+            bestScore = score;
+            bestChild = index;
+        }
+    }
+
+    return bestChild;
+}
+
+Result MonteCarlo::rollout(Position& position, Worker& worker, std::size_t maxPlies) const
+{
+    auto result = Result::None;
+    std::size_t plies = 0;
+    while (result == Result::None && plies < maxPlies)
+    {
+        const auto move = position.sampleMove(worker.mRandom());
+
+        // To try and keep pointless shuffling to a minimum, we'll ignore moving one piece onto an empty square
+        if (move.mDirection != Direction::None && move.mCount == 1)
+        {
+            auto offset = position.getOffset(move.mDirection);
+            if (position[move.mIndex + offset].mCount == 0)
+                continue;
+        }
+
+        position.play(move);
+        result = position.checkResult();
+        ++plies;
+    }
+
+    return result;
+}
+
+// How likely the root player is to win from a leaf which isn't over yet
+float MonteCarlo::leafValue(Position& position, Worker& worker) const
+{
+    if (mOptions.mLeafEvaluation == LeafEvaluation::Rollout)
+        return resultValue(mRootPlayer, rollout(position, worker, std::numeric_limits<std::size_t>::max()));
+
+    const auto result = rollout(position, worker, mOptions.mRolloutPlies);
+    if (result != Result::None)
+        return resultValue(mRootPlayer, result);
+
+    // Both scores end up from white's point of view, and roads saturate the squash to a certain win or loss
+    int score;
+    if (mOptions.mLeafEvaluation == LeafEvaluation::Negamax)
+    {
+        const int colour = position.getPlayer() == Player::White ? 1 : -1;
+        score = worker.mLeafSearch->mSearch.searchToDepth(position, mOptions.mLeafDepth).mScore * colour;
+    }
+    else
+    {
+        score = mOptions.mEvaluator(position);
+    }
+
+    const float whiteValue = 1.0f / (1.0f + std::exp(-mOptions.mEvaluationScale * static_cast<float>(score)));
+    return mRootPlayer == Player::White ? whiteValue : 1.0f - whiteValue;
+}
+
+// Nodes an odd number of moves from the root were reached by the root player's moves
+// The plays were counted on the way down, so only the values are left to add
+void MonteCarlo::backPropagate(float rootPlayerValue, const std::vector<uint32_t>& path)
+{
+    for (std::size_t depth = 0; depth < path.size(); ++depth)
+    {
+        const float value = (depth % 2 == 1) ? rootPlayerValue : 1.0f - rootPlayerValue;
+        std::atomic_ref(mNodes[path[depth]].mValue).fetch_add(value, std::memory_order_relaxed);
+    }
+}
+
+// Returns false if the root has a move which wins straight away, so there's no point searching further
+bool MonteCarlo::playout(const Position& position, Worker& worker)
+{
+    Position nextPosition(position);
+    worker.mPath.clear();
+
+    // Selection and expansion, we expand leaves the second time we reach them
+    uint32_t index = 0;
+    auto result = Result::None;
+    while (true)
+    {
+        auto& node = mNodes[index];
+        worker.mPath.push_back(index);
+        const auto previousPlays = std::atomic_ref(node.mPlayCount).fetch_add(1, std::memory_order_relaxed);
+
+        const auto state = std::atomic_ref(node.mState).load(std::memory_order_acquire);
+        if (state == MonteCarloNode::State::Terminal)
+        {
+            result = std::atomic_ref(node.mResult).load(std::memory_order_relaxed);
+            break;
+        }
+
+        if (state == MonteCarloNode::State::Expanding)
+            break;
+
+        if (state == MonteCarloNode::State::Leaf)
+        {
+            result = nextPosition.checkResult();
+            if (result != Result::None)
+            {
+                std::atomic_ref(node.mResult).store(result, std::memory_order_relaxed);
+                std::atomic_ref(node.mState).store(MonteCarloNode::State::Terminal, std::memory_order_release);
+                break;
+            }
+
+            if (previousPlays == 0 || !expandLeaf(index, nextPosition))
+                break;
+        }
+
+        if (worker.mPath.size() > sMaxTreeDepth)
+            break;
+
+        index = selectChild(node, worker);
+        nextPosition.play(mNodes[index].mMove);
+    }
+
+    if (result == Result::None)
+    {
+        backPropagate(leafValue(nextPosition, worker), worker.mPath);
+        return true;
+    }
+
+    if (worker.mPath.size() == 2 && resultValue(mRootPlayer, result) == 1.0f)
+    {
+        worker.mWinningMove = mNodes[index].mMove; // We can win immediately, wahey!
+        return false;
+    }
+
+    backPropagate(resultValue(mRootPlayer, result), worker.mPath);
+    return true;
+}
+
+void MonteCarlo::runPlayouts(const Position& position, Worker& worker)
+{
+    while (!mStop.load(std::memory_order_relaxed) && timeInMics() < mStopSearchingTime &&
+           mStartedPlayouts.fetch_add(1, std::memory_order_relaxed) < mMaxPlayouts)
+    {
+        if (!playout(position, worker))
+        {
+            mStop = true;
+            break;
+        }
+        ++mPlayouts;
+    }
+}
+
+// Grows this tree from position, with every thread playing out on it if it's shared
+std::size_t MonteCarlo::searchThreadCount() const
+{
+    return mOptions.mParallelism == MonteCarloParallelism::Tree ? std::max<std::size_t>(mOptions.mThreadCount, 1) : 1;
+}
+
+bool MonteCarlo::searchTree(const Position& position, std::size_t maxPlayouts, int64_t stopSearchingTime,
+                            const MoveBuffer& potentialMoves)
+{
+    // Our root holds the other trees' merged playouts too, which they still have themselves, so we don't reuse it
+    uint32_t reusedRoot = potentialMoves.empty() ? findNode(position) : sNoNode;
+    if (reusedRoot == 0 && !mRootTrees.empty())
+        reusedRoot = sNoNode;
+    mRootPosition = position;
+
+    mRootPlayer = position.getPlayer();
+    mMaxPlayouts = maxPlayouts;
+    mStopSearchingTime = stopSearchingTime;
+    mStartedPlayouts = 0;
+    mPlayouts = 0;
+    mStop = false;
+    mWinningMove = Move();
+
+    if (reusedRoot != sNoNode)
+    {
+        const std::size_t previousNodeCount = mNodeCount;
+        reRoot(reusedRoot);
+        mLogger << LogLevel::Debug << "Reusing " << mNodes[0].mPlayCount << " playouts, kept " << mNodeCount
+                << " of " << previousNodeCount << " nodes" << Flush;
+    }
+    else
+    {
+        mNodeCount = 0;
+        std::fill(mTranspositions.begin(), mTranspositions.end(), TranspositionRecord{0, sNoNode});
+        mNodes[0] = {Move(), sNoNode, sNoNode, 0, 0.0f, 1.0f, 0, MonteCarloNode::State::Leaf, Result::None};
+        mNodeCount = 1;
+
+        // We might be selecting between a pre chosen group of moves, which nothing else should share
+        const bool givenMoves = !potentialMoves.empty();
+        if (givenMoves ? !expand(0, position, potentialMoves) : !expandLeaf(0, position))
+            return false;
+    }
+
+    const std::size_t threadCount = searchThreadCount();
+    std::vector<Worker> workers(threadCount);
+    for (std::size_t thread = 0; thread < mLeafSearches.size(); ++thread)
+        workers[thread].mLeafSearch = mLeafSearches[thread].get();
+    std::vector<std::thread> threads;
+    for (std::size_t thread = 1; thread < threadCount; ++thread)
+        threads.emplace_back([&, thread] { runPlayouts(position, workers[thread]); });
+    runPlayouts(position, workers[0]);
+    for (auto& thread : threads)
+        thread.join();
+
+    for (const auto& worker : workers)
+    {
+        if (isSet(worker.mWinningMove))
+            mWinningMove = worker.mWinningMove;
+    }
+
+    return true;
+}
+
+// Every tree expanded the root with the same moves in the same order, so we can add them up child by child
+void MonteCarlo::mergeRootTree(const MonteCarlo& tree)
+{
+    const auto& root = mNodes[0];
+    const auto& treeRoot = tree.mNodes[0];
+    assert(root.mChildCount == treeRoot.mChildCount);
+
+    mNodes[0].mPlayCount += treeRoot.mPlayCount;
+    for (uint32_t child = 0; child < root.mChildCount; ++child)
+    {
+        auto& node = mNodes[root.mFirstChild + child];
+        const auto& treeNode = tree.mNodes[treeRoot.mFirstChild + child];
+        assert(node.mMove == treeNode.mMove);
+        node.mPlayCount += treeNode.mPlayCount;
+        node.mValue += treeNode.mValue;
+    }
+
+    mPlayouts += tree.mPlayouts;
+}
+
+// The node we expanded for position last search, found by its hash and checked by playing the moves down to it
+uint32_t MonteCarlo::findNode(const Position& position) const
+{
+    if (!mRootPosition || mRootPosition->size() != position.size())
+        return sNoNode;
+
+    const auto hash = std::hash<Position>{}(position);
+    const auto& record = mTranspositions[hash % mTranspositions.size()];
+    if (record.mNode == sNoNode || (record.mHashXorNode ^ record.mNode) != hash)
+        return sNoNode;
+
+    std::vector<Move> moves;
+    for (auto index = static_cast<uint32_t>(record.mNode); index != 0; index = mNodes[index].mParent)
+        moves.push_back(mNodes[index].mMove);
+
+    Position reached(*mRootPosition);
+    for (auto move = moves.rbegin(); move != moves.rend(); ++move)
+        reached.play(*move);
+    if (reached != position || reached.getKomi() != position.getKomi() ||
+        reached.isInOpeningSwap() != position.isInOpeningSwap())
+        return sNoNode;
+
+    return static_cast<uint32_t>(record.mNode);
+}
+
+// Moves newRoot to the front of the arena with everything reachable from it after, keeping their order
+// Each child range's mParent becomes the first node we reach it from, as the one which made it may be gone
+void MonteCarlo::reRoot(uint32_t newRoot)
+{
+    const std::size_t nodeCount = mNodeCount;
+    std::vector<uint32_t> newIndices(nodeCount, sNoNode);
+    std::vector<uint32_t> queue{newRoot};
+    for (std::size_t next = 0; next < queue.size(); ++next)
+    {
+        const auto& node = mNodes[queue[next]];
+        if (node.mState != MonteCarloNode::State::Expanded || newIndices[node.mFirstChild] != sNoNode)
+            continue;
+
+        for (uint32_t child = node.mFirstChild; child < node.mFirstChild + node.mChildCount; ++child)
+        {
+            newIndices[child] = 0; // Kept, we number them once we've found them all
+            mNodes[child].mParent = queue[next];
+            queue.push_back(child);
+        }
+    }
+
+    // The old root was never a child, so nothing lands on the front but the new root
+    uint32_t keptCount = 1;
+    for (std::size_t index = 1; index < nodeCount; ++index)
+    {
+        if (newIndices[index] != sNoNode)
+            newIndices[index] = keptCount++;
+    }
+    auto newParent = [&](uint32_t index) { return index == newRoot ? 0 : newIndices[index]; };
+
+    // Transpositions whose node has gone can point at whichever node now owns its children
+    for (auto& record : mTranspositions)
+    {
+        if (record.mNode == sNoNode)
+            continue;
+
+        const auto hash = record.mHashXorNode ^ record.mNode;
+        const auto& node = mNodes[record.mNode];
+        uint32_t newNode = sNoNode;
+        if (record.mNode == newRoot || newIndices[record.mNode] != sNoNode)
+            newNode = newParent(static_cast<uint32_t>(record.mNode));
+        else if (newIndices[node.mFirstChild] != sNoNode)
+            newNode = newParent(mNodes[node.mFirstChild].mParent);
+
+        record = newNode == sNoNode ? TranspositionRecord{0, sNoNode} : TranspositionRecord{hash ^ newNode, newNode};
+    }
+
+    // Every node moves to an index no higher than its own, so sliding them down in order never overwrites one we need
+    auto root = mNodes[newRoot];
+    root.mMove = Move();
+    root.mParent = sNoNode;
+    root.mFirstChild = newIndices[root.mFirstChild];
+    for (std::size_t index = 1; index < nodeCount; ++index)
+    {
+        if (newIndices[index] == sNoNode)
+            continue;
+
+        auto node = mNodes[index];
+        node.mParent = newParent(node.mParent);
+        if (node.mState == MonteCarloNode::State::Expanded)
+            node.mFirstChild = newIndices[node.mFirstChild];
+        mNodes[newIndices[index]] = node;
+    }
+    mNodes[0] = root;
+    mNodeCount = keptCount;
+}
+
+Move MonteCarlo::search(const Position& position, std::size_t maxPlayouts, int64_t stopSearchingTime,
+                        const MoveBuffer& potentialMoves)
+{
+    // Root parallel trees share out the playouts, the first tree taking any left over
+    const std::size_t treeCount = mRootTrees.size() + 1;
+    const std::size_t treePlayouts = maxPlayouts / treeCount;
+    std::vector<std::thread> threads;
+    for (auto& tree : mRootTrees)
+    {
+        threads.emplace_back([&, tree = tree.get()]
+                             { tree->searchTree(position, treePlayouts, stopSearchingTime, potentialMoves); });
+    }
+    const bool searched =
+        searchTree(position, maxPlayouts - treePlayouts * mRootTrees.size(), stopSearchingTime, potentialMoves);
+    for (auto& thread : threads)
+        thread.join();
+
+    if (!searched)
+    {
+        mLogger << LogLevel::Warn << "No moves to search" << Flush;
+        return Move();
+    }
+
+    for (const auto& tree : mRootTrees)
+    {
+        if (isSet(tree->mWinningMove))
+            mWinningMove = tree->mWinningMove;
+        mergeRootTree(*tree);
+    }
+
+    if (isSet(mWinningMove))
+        return mWinningMove;
+
+    mLogger << LogLevel::Info << "Searched " << mPlayouts << " playouts with " << mNodeCount << " nodes" << Flush;
+
+    // The most played move rather than the best win rate, which a handful of lucky playouts can top
+    const auto& root = mNodes[0];
+    const MonteCarloNode* bestNode = nullptr;
+    for (uint32_t index = root.mFirstChild; index < root.mFirstChild + root.mChildCount; ++index)
+    {
+        const auto& node = mNodes[index];
+        if (node.mPlayCount == 0)
+        {
+            mLogger << LogLevel::Warn << "Unplayed top level move " << moveToPtn(node.mMove, position.size())
+                    << Flush;
+            continue;
+        }
+
+        if (!bestNode || node.mPlayCount > bestNode->mPlayCount ||
+            (node.mPlayCount == bestNode->mPlayCount && node.winRate() > bestNode->winRate()))
+        {
+            mLogger << LogLevel::Debug << moveToPtn(node.mMove, position.size()) << " is new best move, wins "
+                    << node.mValue << " out of " << node.mPlayCount << Flush;
+            bestNode = &node;
+        }
+    }
+
+    return bestNode ? bestNode->mMove : mNodes[root.mFirstChild].mMove;
+}
+
+std::size_t MonteCarlo::getMemoryUsage() const
+{
+    std::size_t bytes = mMaxNodes * sizeof(MonteCarloNode) + mTranspositions.size() * sizeof(TranspositionRecord);
+    for (const auto& leafSearch : mLeafSearches)
+        bytes += leafSearch->mEvaluationCache.getMemoryUsage();
+    for (const auto& tree : mRootTrees)
+        bytes += tree->getMemoryUsage();
+    return bytes;
+}
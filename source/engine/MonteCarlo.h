@@ -1,186 +1,203 @@
 #pragma once
 
 #include "Engine.h"
+#include "EvaluationCache.h"
+#include "TranspositionTable.h"
 #include "log/Logger.h"
-#include "other/Time.h"
+#include "other/Xoshiro.h"
+#include "tak/Move.h"
+#include "tak/Player.h"
 #include "tak/Position.h"
-#include "tak/RobinHoodHashes.h"
+#include "tak/Result.h"
 
+#include <atomic>
 #include <cstddef>
-#include <functional>
-#include <unordered_map>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <random>
+#include <span>
 #include <vector>
 
-struct Node
+// One position in the tree, reached from its parent by mMove
+// Children sit next to each other in the arena, so a node only needs the first one's index and how many there are
+// While threads share the tree, mPlayCount, mValue, mState and mResult are only touched through std::atomic_ref
+struct MonteCarloNode
 {
-    Node* mParent;
-
-    std::size_t mPlayCount;
-    std::size_t mWinCount; // Games are either won or not, but draws aren't common in Tak
-
-    // Node(Position rootPosition) : mParent(nullptr), mPosition(rootPosition), mPlayCount(0), mWinCount(0) { }
-    // Node(Node* parent, Position position) : mParent(parent), mPosition(position), mPlayCount(0), mWinCount(0) { }
-    Node() : mParent(nullptr), mPlayCount(0), mWinCount(0)
+    enum class State : uint8_t
     {
-    }
-    Node(Node* parent) : mParent(parent), mPlayCount(0), mWinCount(0)
+        Leaf,      // Not expanded yet, we roll out from here
+        Expanding, // A thread is making the children, the others roll out from here until it's done
+        Expanded,  // mFirstChild and mChildCount are set
+        Terminal   // The game is over, mValue adds up the result every visit
+    };
+
+    Move mMove;
+    uint32_t mParent;     // The node this was first expanded under, transpositions can share its children
+    uint32_t mFirstChild;
+    uint32_t mPlayCount;  // Counted as we descend, so until the result comes back it's a virtual loss
+    float mValue;         // Summed results for the player who played mMove, a win is 1 and a draw 0.5
+    float mPrior;         // How likely scoreMove thinks mMove is the one to play, for PUCT
+    uint16_t mChildCount; // Even 8s positions with every stack spread every way have fewer moves than this can hold
+    State mState;
+    Result mResult;       // Only for State::Terminal
+
+    float winRate() const
     {
+        return mPlayCount ? mValue / static_cast<float>(mPlayCount) : 0.0f;
     }
 };
 
-bool resultIsAWin(Player colour, Result result)
-{
-    if ((colour == Player::Black && result & StoneBits::Black) ||
-        (colour == Player::White && !(result & StoneBits::Black)))
-        return true;
-
-    return false; // Draws count as losses
-}
+static_assert(sizeof(MonteCarloNode) == 32); // Two to a cache line
 
-Move monteCarloTreeSearch(const Position& position, int maxSeconds = 1, const MoveBuffer potentialMoves = {})
+enum class MonteCarloSelection : uint8_t
 {
-    Logger logger("MonteCarlo");
-
-    auto endTime = timeInMics() + (maxSeconds * micsInSecond);
-    robin_hood::unordered_map<Position, Node*, Hash<Position>> nodes;
-    auto root = new Node();
-    nodes[position] = root;
-    auto colour = position.getPlayer();
+    Random, // Uniformly random descent, tree statistics only pick the move at the end
+    Uct,    // Win rate plus mExploration * sqrt(ln parent plays / plays), trying every child once first
+    Puct    // Win rate plus mExploration * prior * sqrt(parent plays) / (1 + plays), with priors from scoreMove
+};
 
-    bool givenMoves = !potentialMoves.empty();
+enum class MonteCarloParallelism : uint8_t
+{
+    Tree, // Every thread plays out on one shared tree, virtual losses keep them from all trying the same line
+    Root  // Each thread grows its own tree, and we add up their root moves' statistics at the end
+};
 
-    std::size_t nodeCount = 0;
-    while (timeInMics() < endTime)
+struct MonteCarloOptions
+{
+    MonteCarloSelection mSelection;
+    float mExploration;
+    std::size_t mThreadCount;
+    MonteCarloParallelism mParallelism;
+
+    // How leaves are valued, see LeafEvaluation
+    LeafEvaluation mLeafEvaluation{LeafEvaluation::Rollout};
+    std::size_t mRolloutPlies{0};
+    int mLeafDepth{1};
+    EvaluationFunction mEvaluator{gDefaultEvaluator};
+    float mEvaluationScale{0.02f}; // Win probability is sigmoid(scale * score), so a flat or so ahead is about 60%
+
+    MonteCarloOptions(MonteCarloSelection selection = MonteCarloSelection::Uct, float exploration = 0.7f,
+                      std::size_t threadCount = 1, MonteCarloParallelism parallelism = MonteCarloParallelism::Tree)
+        : mSelection(selection), mExploration(exploration), mThreadCount(threadCount), mParallelism(parallelism)
     {
-        Position nextPosition(position);
-        Node* parent = nullptr;
-
-        // Selection
-        while (nodes.contains(nextPosition))
-        {
-            MoveBuffer moves;
-
-            // We might be selecting between a pre chosen group of moves
-            if (givenMoves && parent == nullptr)
-                moves = potentialMoves;
-            else
-                moves = nextPosition.generateMoves();
-
-            parent = nodes[nextPosition];
-            auto move = *chooseRandomElement(moves);
-            nextPosition.play(move);
-
-            auto result = nextPosition.checkResult();
-            if (result != Result::None)
-            {
-                bool wonGame = resultIsAWin(colour, result);
-
-                // If this was an immediate win or loss
-                if (parent == root)
-                {
-                    if (wonGame)
-                        return move; // We can win immediately, wahey!
-                    else
-                    {
-                        // This move actually gave the opponent the win!
-                        // Let's just reset and hope this doesn't happen again
-                        nextPosition = position;
-                    }
-                }
-                else
-                {
-                    // Backpropogate the result
-                    while (parent->mParent != nullptr)
-                    {
-                        ++(parent->mPlayCount);
-                        if (wonGame)
-                            ++(parent->mWinCount);
-                        parent = parent->mParent;
-                    }
-                    ++nodeCount;
-                }
-            }
-        }
-
-        // Expansion
-        auto* node = new Node(parent);
-        nodes[nextPosition] = node;
-
-        // Rollout
-        auto result = Result::None; // We checked for this earlier
-        while (result == Result::None)
-        {
-            auto moves = nextPosition.generateMoves();
-            auto move = *chooseRandomElement(moves);
-
-            // To try and keep pointless shuffling to a minimum, we'll ignore moving one piece onto an empty square
-            if (move.mDirection != Direction::None && move.mCount == 1)
-            {
-                auto offset = position.getOffset(move.mDirection);
-                if (position[move.mIndex + offset].mCount == 0)
-                    continue;
-            }
-
-            nextPosition.play(move);
-            result = nextPosition.checkResult();
-        }
-
-        bool wonGame = resultIsAWin(colour, result);
-
-        // Back Propogation
-        while (node->mParent != nullptr)
-        {
-            ++(node->mPlayCount);
-            if (wonGame)
-                ++(node->mWinCount);
-            node = node->mParent;
-        }
-        ++nodeCount;
     }
 
-    logger << LogLevel::Info << "Searched " << nodeCount << " nodes" << Flush;
-
-    const Move* bestMove = nullptr;
-    Node* bestNode = nullptr;
+    // What Engine searches with, PUCT as it converged fastest in bench's Monte Carlo convergence test
+    explicit MonteCarloOptions(const EngineOptions& engineOptions)
+        : MonteCarloOptions(MonteCarloSelection::Puct, 0.7f, engineOptions.mThreadCount)
+    {
+        mLeafEvaluation = engineOptions.mLeafEvaluation;
+        mRolloutPlies = engineOptions.mRolloutPlies;
+        mLeafDepth = engineOptions.mLeafDepth;
+        mEvaluator = engineOptions.mEvaluator;
+    }
+};
 
-    MoveBuffer moves;
-    // We might be selecting between a pre chosen group of moves
-    if (givenMoves)
-        moves = potentialMoves;
-    else
-        moves = position.generateMoves();
+// A cheap guess at how good a move is without playing it, positive and larger for better moves
+float scoreMove(const Position& position, const Move& move);
 
-    for (auto& move : moves)
+// Monte Carlo tree search over a preallocated arena of nodes, which is never freed between searches
+// Positions we reach again by another order of moves share the children of the first node we expanded for them
+// If the next search starts from a position we already expanded, we keep its subtree and compact away the rest
+class MonteCarlo
+{
+    // Written without a lock, so we store the hash XORed with the node and a torn write fails the check
+    struct TranspositionRecord
     {
-        Position nextPosition(position);
-        nextPosition.play(move);
+        uint64_t mHashXorNode;
+        uint64_t mNode;
+    };
 
-        if (!(nodes.contains(nextPosition)))
+    // A shallow negamax for LeafEvaluation::Negamax, with tables of its own so threads needn't share them
+    // The leaf searches are too short for a transposition table to pay off, but SearchCore needs one to point at
+    struct LeafSearch
+    {
+        TranspositionTable mTranspositionTable{1};
+        EvaluationCache mEvaluationCache;
+        EngineStats mStats;
+        SearchCore<EvaluatorFunction, SearchFeatures> mSearch;
+
+        explicit LeafSearch(EvaluationFunction evaluator)
+            : mSearch(EvaluatorFunction{evaluator}, SearchFeatures{true, true, false, true, true, true},
+                      mTranspositionTable, mEvaluationCache, mStats)
         {
-            logger << LogLevel::Warn << "Unplayed top level move " << moveToPtn(move, position.size()) << Flush;
-            continue;
         }
+    };
 
-        auto* node = nodes.at(nextPosition);
-
-        double bestNodeRatio =
-            bestNode ? static_cast<double>(bestNode->mWinCount) / static_cast<double>(bestNode->mPlayCount) : 0.0;
-        double nodeRatio = static_cast<double>(node->mWinCount) / static_cast<double>(node->mPlayCount);
+    // What each thread needs for itself while it plays out
+    struct Worker
+    {
+        std::vector<uint32_t> mPath; // The nodes the current playout went through, root first
+        Xoshiro256 mRandom{std::random_device{}()};
+        Move mWinningMove;
+        LeafSearch* mLeafSearch{nullptr}; // Only with LeafEvaluation::Negamax
 
-        if (nodeRatio >= bestNodeRatio) // If this is the first move we've seen, pick it
+        Worker()
         {
-            std::string ptnMove = moveToPtn(move, position.size());
-            logger << LogLevel::Info << ptnMove << " is new best move, wins " << node->mWinCount << " out of "
-                   << node->mPlayCount << Flush;
-
-            bestMove = &move;
-            bestNode = node;
-            continue;
+            mPath.reserve(sMaxTreeDepth + 1);
         }
+    };
+
+    Logger mLogger{"MonteCarlo"};
+    const MonteCarloOptions mOptions;
+
+    const std::size_t mMaxNodes;
+    std::unique_ptr<MonteCarloNode[]> mNodes; // Allocated up front, threads take child ranges by bumping mNodeCount
+    std::atomic<std::size_t> mNodeCount{0};
+    std::vector<TranspositionRecord> mTranspositions;
+    std::vector<std::unique_ptr<MonteCarlo>> mRootTrees; // The other threads' trees with MonteCarloParallelism::Root
+
+    // One per thread with LeafEvaluation::Negamax, made once rather than per search as each caches a Meg of evaluations
+    std::vector<std::unique_ptr<LeafSearch>> mLeafSearches;
+
+    // The current search, shared by every thread playing out on this tree
+    Player mRootPlayer{Player::White};
+    std::size_t mMaxPlayouts{0};
+    int64_t mStopSearchingTime{0};
+    std::atomic<std::size_t> mStartedPlayouts{0};
+    std::atomic<std::size_t> mPlayouts{0};
+    std::atomic<bool> mStop{false};
+    Move mWinningMove;
+    std::optional<Position> mRootPosition; // Where the last search started, the tree's moves are played from here
+
+    bool expand(uint32_t index, const Position& position, const MoveBuffer& moves);
+    bool expandLeaf(uint32_t index, const Position& position);
+    uint32_t selectChild(const MonteCarloNode& node, Worker& worker) const;
+    Result rollout(Position& position, Worker& worker, std::size_t maxPlies) const;
+    float leafValue(Position& position, Worker& worker) const;
+    void backPropagate(float rootPlayerValue, const std::vector<uint32_t>& path);
+    bool playout(const Position& position, Worker& worker);
+    void runPlayouts(const Position& position, Worker& worker);
+    std::size_t searchThreadCount() const; // Threads playing out on this tree, the root trees have their own
+    bool searchTree(const Position& position, std::size_t maxPlayouts, int64_t stopSearchingTime,
+                    const MoveBuffer& potentialMoves);
+    void mergeRootTree(const MonteCarlo& tree);
+    uint32_t findNode(const Position& position) const;
+    void reRoot(uint32_t newRoot);
+
+public:
+    static constexpr uint32_t sNoNode = std::numeric_limits<uint32_t>::max();
+    static constexpr std::size_t sDefaultMaxNodes = 1 << 21; // 2 million nodes * 32 bytes = 64 Megs
+    static constexpr std::size_t sTranspositionTableSize = 1 << 20; // 1 million entries * 16 bytes = 16 Megs
+    static constexpr std::size_t sMaxTreeDepth = 128; // Shared children can loop back round, so we stop descending
+
+    // With MonteCarloParallelism::Root the threads' trees split maxNodes between them
+    explicit MonteCarlo(std::size_t maxNodes = sDefaultMaxNodes, MonteCarloOptions options = MonteCarloOptions());
+
+    // Plays out until either limit, potentialMoves restricts the moves we choose between at the root
+    // Without potentialMoves we carry on from the last search's tree if it reached position
+    Move search(const Position& position, std::size_t maxPlayouts, int64_t stopSearchingTime,
+                const MoveBuffer& potentialMoves = {});
+
+    std::span<const MonteCarloNode> getNodes() const
+    {
+        return {mNodes.get(), mNodeCount.load()};
     }
-
-    for (auto [position, node] : nodes)
-        delete node;
-
-    return *bestMove;
-}
+    std::size_t getPlayouts() const
+    {
+        return mPlayouts;
+    }
+    std::size_t getMemoryUsage() const; // Allocated up front, so the same whatever we've searched
+};
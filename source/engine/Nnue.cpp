@@ -0,0 +1,275 @@
+// The intrinsics headers go first, as EnumBitOps' operators trip over their enums
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define NNUE_KERNELS_X86
+#endif
+
+#include "Nnue.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <random>
+
+// The file is "TAKNNUE1", the three layer sizes as uint32s, then every array in the order NnueNetwork declares them
+// Everything is little endian, written straight from memory
+static constexpr char sMagic[8] = {'T', 'A', 'K', 'N', 'N', 'U', 'E', '1'};
+
+NnueNetwork gNnueNetwork;
+
+// Never reused, so a cache can't mistake another network's weights, or ones we've since replaced, for ours
+static std::atomic<uint64_t> sNextWeightsId{1};
+
+int nnueEvaluate(const Position& position)
+{
+    return gNnueNetwork.evaluate(position);
+}
+
+NnueKernel bestNnueKernel()
+{
+#ifdef NNUE_KERNELS_X86
+    static const NnueKernel best = __builtin_cpu_supports("avx2") ? NnueKernel::Avx2 : NnueKernel::Scalar;
+    return best;
+#else
+    return NnueKernel::Scalar;
+#endif
+}
+
+NnueNetwork::NnueNetwork() : mWeightsId(sNextWeightsId++), mFeatureWeights(sNnueFeatures * sNnueAccumulatorSize)
+{
+}
+
+template <typename Array> static void writeArray(std::ofstream& file, const Array& array)
+{
+    file.write(reinterpret_cast<const char*>(array.data()), array.size() * sizeof(array[0]));
+}
+
+template <typename Array> static void readArray(std::ifstream& file, Array& array)
+{
+    file.read(reinterpret_cast<char*>(array.data()), array.size() * sizeof(array[0]));
+}
+
+bool NnueNetwork::load(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    char magic[sizeof(sMagic)];
+    std::array<uint32_t, 3> sizes{};
+    file.read(magic, sizeof(magic));
+    readArray(file, sizes);
+    if (!file || std::memcmp(magic, sMagic, sizeof(sMagic)) != 0)
+    {
+        mLogger << LogLevel::Error << "Couldn't read a network from " << path << Flush;
+        return false;
+    }
+
+    if (sizes[0] != sNnueFeatures || sizes[1] != sNnueAccumulatorSize || sizes[2] != sHiddenSize)
+    {
+        mLogger << LogLevel::Error << "Network " << path << " has layers " << sizes[0] << "x" << sizes[1] << "x"
+                << sizes[2] << " but we expected " << sNnueFeatures << "x" << sNnueAccumulatorSize << "x"
+                << sHiddenSize << Flush;
+        return false;
+    }
+
+    mWeightsId = sNextWeightsId++; // Even if we fail from here, as we've started overwriting the old weights
+    readArray(file, mFeatureWeights);
+    readArray(file, mFeatureBiases);
+    readArray(file, mHiddenWeights);
+    readArray(file, mHiddenBiases);
+    readArray(file, mOutputWeights);
+    file.read(reinterpret_cast<char*>(&mOutputBias), sizeof(mOutputBias));
+    if (!file)
+    {
+        mLogger << LogLevel::Error << "Network " << path << " ended early" << Flush;
+        return false;
+    }
+
+    mLogger << LogLevel::Info << "Loaded network " << path << Flush;
+    return true;
+}
+
+bool NnueNetwork::save(const std::string& path) const
+{
+    std::ofstream file(path, std::ios::binary);
+    const std::array<uint32_t, 3> sizes{sNnueFeatures, sNnueAccumulatorSize, sHiddenSize};
+    file.write(sMagic, sizeof(sMagic));
+    writeArray(file, sizes);
+    writeArray(file, mFeatureWeights);
+    writeArray(file, mFeatureBiases);
+    writeArray(file, mHiddenWeights);
+    writeArray(file, mHiddenBiases);
+    writeArray(file, mOutputWeights);
+    file.write(reinterpret_cast<const char*>(&mOutputBias), sizeof(mOutputBias));
+    return static_cast<bool>(file);
+}
+
+void NnueNetwork::randomise(uint64_t seed)
+{
+    std::mt19937_64 random(seed);
+    auto between = [&](int low, int high) { return std::uniform_int_distribution<int>(low, high)(random); };
+
+    // Small enough that a full board's accumulator can't overflow an int16
+    for (auto& weight : mFeatureWeights)
+        weight = static_cast<int16_t>(between(-32, 32));
+    for (auto& bias : mFeatureBiases)
+        bias = static_cast<int16_t>(between(0, 64));
+    for (auto& weight : mHiddenWeights)
+        weight = static_cast<int8_t>(between(-64, 64));
+    for (auto& bias : mHiddenBiases)
+        bias = between(-1024, 1024);
+    for (auto& weight : mOutputWeights)
+        weight = static_cast<int8_t>(between(-64, 64));
+    mOutputBias = 0;
+
+    mWeightsId = sNextWeightsId++;
+}
+
+// Stacks are bucketed by how many of the stones under the top are the top stone's colour, and how many aren't
+static std::size_t nnueStackBucket(const Square& square)
+{
+    const uint32_t below = square.mCount - 1;
+    const uint32_t blackBelow = std::popcount(square.mStack & ((uint32_t{1} << below) - 1));
+    const uint32_t whiteBelow = below - blackBelow;
+    const bool topIsBlack = square.mTopStone & StoneBits::Black;
+
+    const uint32_t own = std::min(topIsBlack ? blackBelow : whiteBelow, 3u);
+    const uint32_t captives = std::min(topIsBlack ? whiteBelow : blackBelow, 3u);
+    return own * 4 + captives;
+}
+
+// Only meaningful for occupied squares
+static std::size_t nnueFeature(std::size_t index, const Square& square)
+{
+    const std::size_t stoneType = isCap(square.mTopStone) ? 2 : isWall(square.mTopStone) ? 1 : 0;
+    const std::size_t topStone = stoneType + (square.mTopStone & StoneBits::Black ? 3 : 0);
+    return (index * sNnueTopStones + topStone) * sNnueStackBuckets + nnueStackBucket(square);
+}
+
+// Plain loops over int16s, which the compiler vectorises well enough for a handful of squares per move
+void NnueNetwork::addFeature(NnueAccumulator& accumulator, std::size_t index, const Square& square, int sign) const
+{
+    if (square.mTopStone == Stone::Blank)
+        return;
+
+    const int16_t* weights = mFeatureWeights.data() + nnueFeature(index, square) * sNnueAccumulatorSize;
+    if (sign > 0)
+    {
+        for (std::size_t input = 0; input < sNnueAccumulatorSize; ++input)
+            accumulator.mValues[input] += weights[input];
+    }
+    else
+    {
+        for (std::size_t input = 0; input < sNnueAccumulatorSize; ++input)
+            accumulator.mValues[input] -= weights[input];
+    }
+}
+
+NnueAccumulator NnueNetwork::accumulate(const Position& position) const
+{
+    NnueAccumulator accumulator;
+    for (std::size_t index = 0; index < position.size() * position.size(); ++index)
+        addFeature(accumulator, index, position[index], 1);
+
+    return accumulator;
+}
+
+const NnueAccumulator& NnueNetwork::accumulate(const Position& position, NnueAccumulatorCache& cache) const
+{
+    const std::size_t size = position.size();
+    if (cache.mWeightsId != mWeightsId || cache.mSize != size)
+    {
+        // Start again from an empty board, which every square then differs from
+        cache.mWeightsId = mWeightsId;
+        cache.mSize = size;
+        cache.mBoard = {};
+        cache.mAccumulator = {};
+    }
+
+    for (std::size_t index = 0; index < size * size; ++index)
+    {
+        // Square's operator== isn't inline, and this is most of the work for positions close to the last
+        const Square& square = position[index];
+        Square& cached = cache.mBoard[index];
+        if (square.mTopStone == cached.mTopStone && square.mCount == cached.mCount && square.mStack == cached.mStack)
+            continue;
+
+        addFeature(cache.mAccumulator, index, cached, -1);
+        addFeature(cache.mAccumulator, index, square, 1);
+        cached = square;
+    }
+
+    return cache.mAccumulator;
+}
+
+static uint8_t clipToInt8(int32_t value)
+{
+    return static_cast<uint8_t>(std::clamp(value, 0, 127));
+}
+
+static void hiddenLayerScalar(const std::array<uint8_t, sNnueAccumulatorSize>& inputs, const int8_t* weights,
+                              const int32_t* biases, std::array<uint8_t, NnueNetwork::sHiddenSize>& hidden)
+{
+    for (std::size_t neuron = 0; neuron < NnueNetwork::sHiddenSize; ++neuron)
+    {
+        int32_t sum = 0;
+        for (std::size_t input = 0; input < sNnueAccumulatorSize; ++input)
+            sum += inputs[input] * weights[neuron * sNnueAccumulatorSize + input];
+
+        hidden[neuron] = clipToInt8((sum + biases[neuron]) >> NnueNetwork::sHiddenShift);
+    }
+}
+
+#ifdef NNUE_KERNELS_X86
+// maddubs multiplies our unsigned inputs by the signed weights and adds neighbouring pairs into int16s,
+// which can't saturate as both are at most 127 in size, then madd with ones widens those pairs into int32s
+__attribute__((target("avx2"))) static void hiddenLayerAvx2(const std::array<uint8_t, sNnueAccumulatorSize>& inputs,
+                                                            const int8_t* weights, const int32_t* biases,
+                                                            std::array<uint8_t, NnueNetwork::sHiddenSize>& hidden)
+{
+    static_assert(sNnueAccumulatorSize == 64);
+    const __m256i ones = _mm256_set1_epi16(1);
+    const __m256i lowInputs = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(inputs.data()));
+    const __m256i highInputs = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(inputs.data() + 32));
+
+    for (std::size_t neuron = 0; neuron < NnueNetwork::sHiddenSize; ++neuron)
+    {
+        const int8_t* row = weights + neuron * sNnueAccumulatorSize;
+        const __m256i lowWeights = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row));
+        const __m256i highWeights = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + 32));
+
+        const __m256i lowSums = _mm256_madd_epi16(_mm256_maddubs_epi16(lowInputs, lowWeights), ones);
+        const __m256i highSums = _mm256_madd_epi16(_mm256_maddubs_epi16(highInputs, highWeights), ones);
+        const __m256i sums = _mm256_add_epi32(lowSums, highSums);
+
+        __m128i quads = _mm_add_epi32(_mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1));
+        quads = _mm_add_epi32(quads, _mm_shuffle_epi32(quads, 0b01001110));
+        quads = _mm_add_epi32(quads, _mm_shuffle_epi32(quads, 0b10110001));
+
+        hidden[neuron] = clipToInt8((_mm_cvtsi128_si32(quads) + biases[neuron]) >> NnueNetwork::sHiddenShift);
+    }
+}
+#endif
+
+int NnueNetwork::evaluate(const Position& position, NnueKernel kernel) const
+{
+    static thread_local NnueAccumulatorCache cache;
+    const NnueAccumulator& accumulator = accumulate(position, cache);
+    std::array<uint8_t, sNnueAccumulatorSize> inputs;
+    for (std::size_t index = 0; index < sNnueAccumulatorSize; ++index)
+        inputs[index] = clipToInt8(accumulator.mValues[index] + mFeatureBiases[index]);
+
+    std::array<uint8_t, sHiddenSize> hidden;
+#ifdef NNUE_KERNELS_X86
+    if (kernel == NnueKernel::Avx2 && bestNnueKernel() == NnueKernel::Avx2)
+        hiddenLayerAvx2(inputs, mHiddenWeights.data(), mHiddenBiases.data(), hidden);
+    else
+#endif
+        hiddenLayerScalar(inputs, mHiddenWeights.data(), mHiddenBiases.data(), hidden);
+
+    int32_t output = mOutputBias;
+    for (std::size_t neuron = 0; neuron < sHiddenSize; ++neuron)
+        output += hidden[neuron] * mOutputWeights[neuron];
+
+    return output / sOutputDivisor;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "log/Logger.h"
+#include "tak/Position.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class NnueKernel : uint8_t
+{
+    Scalar,
+    Avx2
+};
+
+NnueKernel bestNnueKernel(); // The fastest kernel this CPU supports, checked once
+
+// The inputs, one feature per (square, top stone, stack bucket), see nnueFeature in Nnue.cpp
+inline constexpr std::size_t sNnueSquares = 64;
+inline constexpr std::size_t sNnueTopStones = 6; // Flat, wall or cap, for each player
+inline constexpr std::size_t sNnueStackBuckets = 16;
+inline constexpr std::size_t sNnueFeatures = sNnueSquares * sNnueTopStones * sNnueStackBuckets;
+inline constexpr std::size_t sNnueAccumulatorSize = 64;
+
+// The first layer's sums of feature weights, before its biases
+struct NnueAccumulator
+{
+    std::array<int16_t, sNnueAccumulatorSize> mValues{};
+
+    bool operator==(const NnueAccumulator& other) const = default;
+};
+
+// The last board accumulated and its accumulator, so the next only has to add and remove the squares which changed
+// Positions don't carry accumulators, so the handcrafted evaluation doesn't pay to copy them
+struct NnueAccumulatorCache
+{
+    uint64_t mWeightsId{0}; // Which weights mAccumulator summed, zero before it's been filled
+    std::size_t mSize{0};
+    std::array<Square, 64> mBoard{};
+    NnueAccumulator mAccumulator;
+};
+
+// An efficiently updatable neural network (NNUE) evaluation, an alternative to the handcrafted evaluate
+// Its first layer is an accumulator, which we clip to int8 and feed through a small int8 hidden layer to one output
+class NnueNetwork
+{
+public:
+    static constexpr std::size_t sHiddenSize = 16;
+    static constexpr int sHiddenShift = 6;    // Hidden sums are divided by 64 before clipping to 0..127
+    static constexpr int sOutputDivisor = 16; // The output is in 16ths of the handcrafted evaluation's units
+
+private:
+    Logger mLogger{"Nnue"};
+
+    uint64_t mWeightsId;                  // Unique to these weights, changing whenever we load or randomise
+    std::vector<int16_t> mFeatureWeights; // sNnueFeatures rows of sNnueAccumulatorSize
+    std::array<int16_t, sNnueAccumulatorSize> mFeatureBiases{};
+    std::array<int8_t, sHiddenSize * sNnueAccumulatorSize> mHiddenWeights{}; // A row per hidden neuron
+    std::array<int32_t, sHiddenSize> mHiddenBiases{};
+    std::array<int8_t, sHiddenSize> mOutputWeights{};
+    int32_t mOutputBias{0};
+
+public:
+    NnueNetwork();
+
+    // See Nnue.cpp for the file format
+    bool load(const std::string& path);
+    bool save(const std::string& path) const;
+
+    // Small random weights, for tests and benches while we don't have a trained network
+    void randomise(uint64_t seed);
+
+    // From scratch, or from whatever board the cache last held, after which it holds this position's
+    NnueAccumulator accumulate(const Position& position) const;
+    const NnueAccumulator& accumulate(const Position& position, NnueAccumulatorCache& cache) const;
+
+    // Returns a score from white's point of view, using a cache per thread
+    int evaluate(const Position& position, NnueKernel kernel = bestNnueKernel()) const;
+
+private:
+    void addFeature(NnueAccumulator& accumulator, std::size_t index, const Square& square, int sign) const;
+};
+
+extern NnueNetwork gNnueNetwork;
+
+// An EvaluationFunction using gNnueNetwork
+int nnueEvaluate(const Position& position);
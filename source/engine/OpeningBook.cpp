@@ -3,12 +3,143 @@
 #include "other/StringOps.h"
 #include "tak/Game.h"
 
-#include <cassert>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <fstream>
 
-std::size_t calcMoveIndex(uint8_t rowIndex, uint8_t colIndex, std::size_t boardSize)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static constexpr char bookMagic[8] = {'T', 'A', 'K', 'B', 'O', 'O', 'K', '1'};
+
+struct BookHeader
+{
+    char mMagic[8];
+    uint8_t mSize;
+    int8_t mKomi; // In half points
+    uint8_t mPadding[6];
+    uint64_t mPositionCount;
+    uint64_t mMoveCount;
+};
+
+static_assert(sizeof(BookHeader) == 32); // Keeps the positions after it aligned
+
+uint64_t OpeningBook::hash(const Position& position)
+{
+    const uint64_t side = position.size() * 2 + (position.getPlayer() == Player::Black ? 1 : 0);
+    uint64_t key = position.getSquareTerms().mBoardHash + side * 0x9e3779b97f4a7c15;
+    key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9;
+    key = (key ^ (key >> 27)) * 0x94d049bb133111eb;
+    return key ^ (key >> 31);
+}
+
+OpeningBookBuilder::OpeningBookBuilder(std::size_t size, double komi) : mSize(size), mKomi(komi)
 {
-    return (rowIndex * boardSize) + colIndex;
+}
+
+void OpeningBookBuilder::add(const Position& position, const Move& move, float score)
+{
+    assert(position.size() == mSize);
+    const Shift canonicalShift = position.getCanonicalShift();
+    const Position canonicalPosition = position.shift(canonicalShift);
+    const Move canonicalMove = position.shiftMove(move, canonicalShift);
+
+    auto& tallies = mPositions[OpeningBook::hash(canonicalPosition)];
+    auto tally = std::find_if(tallies.begin(), tallies.end(),
+                              [&](const Tally& tally) { return tally.mMove == canonicalMove; });
+    if (tally == tallies.end())
+        tally = tallies.insert(tallies.end(), Tally{canonicalMove, 0, 0.0});
+
+    ++tally->mWeight;
+    tally->mScoreSum += score;
+}
+
+bool OpeningBookBuilder::addLine(const std::string& line)
+{
+    Position position(mSize, mKomi);
+    for (const auto& ptn : split(line, ' '))
+    {
+        const Move move = position.ptnToMove(PtnTurn(ptn));
+        const auto moves = position.generateMoves();
+        if (std::find(moves.begin(), moves.end(), move) == moves.end())
+            return false;
+
+        add(position, move);
+        position.play(move);
+    }
+
+    return true;
+}
+
+void OpeningBookBuilder::merge(const OpeningBookBuilder& other)
+{
+    assert(other.mSize == mSize);
+    for (const auto& [hash, otherTallies] : other.mPositions)
+    {
+        auto& tallies = mPositions[hash];
+        for (const auto& otherTally : otherTallies)
+        {
+            auto tally = std::find_if(tallies.begin(), tallies.end(),
+                                      [&](const Tally& tally) { return tally.mMove == otherTally.mMove; });
+            if (tally == tallies.end())
+                tally = tallies.insert(tallies.end(), Tally{otherTally.mMove, 0, 0.0});
+
+            tally->mWeight += otherTally.mWeight;
+            tally->mScoreSum += otherTally.mScoreSum;
+        }
+    }
+}
+
+void OpeningBookBuilder::prune(uint32_t minWeight)
+{
+    for (auto entry = mPositions.begin(); entry != mPositions.end();)
+    {
+        std::erase_if(entry->second, [&](const Tally& tally) { return tally.mWeight < minWeight; });
+        entry = entry->second.empty() ? mPositions.erase(entry) : std::next(entry);
+    }
+}
+
+void OpeningBookBuilder::compile(std::vector<BookPosition>& positions, std::vector<BookMove>& moves) const
+{
+    positions.clear();
+    moves.clear();
+    for (const auto& [hash, tallies] : mPositions)
+        positions.push_back({hash, 0, static_cast<uint32_t>(tallies.size())});
+    std::sort(positions.begin(), positions.end(),
+              [](const BookPosition& a, const BookPosition& b) { return a.mHash < b.mHash; });
+
+    // Each position's moves go most played first
+    for (auto& position : positions)
+    {
+        position.mFirstMove = static_cast<uint32_t>(moves.size());
+        for (const auto& tally : mPositions.at(position.mHash))
+            moves.push_back({tally.mMove, tally.mWeight, static_cast<float>(tally.mScoreSum / tally.mWeight)});
+        std::stable_sort(moves.begin() + position.mFirstMove, moves.end(),
+                         [](const BookMove& a, const BookMove& b) { return a.mWeight > b.mWeight; });
+    }
+}
+
+bool OpeningBookBuilder::write(const std::string& path) const
+{
+    std::vector<BookPosition> positions;
+    std::vector<BookMove> moves;
+    compile(positions, moves);
+
+    BookHeader header{};
+    std::memcpy(header.mMagic, bookMagic, sizeof(bookMagic));
+    header.mSize = static_cast<uint8_t>(mSize);
+    header.mKomi = static_cast<int8_t>(std::lround(mKomi * 2));
+    header.mPositionCount = positions.size();
+    header.mMoveCount = moves.size();
+
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(positions.data()), positions.size() * sizeof(BookPosition));
+    file.write(reinterpret_cast<const char*>(moves.data()), moves.size() * sizeof(BookMove));
+    return static_cast<bool>(file);
 }
 
 OpeningBook::OpeningBook(const std::string& openingBookFile)
@@ -16,51 +147,141 @@ OpeningBook::OpeningBook(const std::string& openingBookFile)
     if (openingBookFile.empty())
         return;
 
+    char magic[sizeof(bookMagic)] = {};
+    std::ifstream(openingBookFile, std::ios::binary).read(magic, sizeof(magic));
+    if (std::memcmp(magic, bookMagic, sizeof(bookMagic)) == 0)
+    {
+        if (!map(openingBookFile))
+            return;
+    }
+    else
+    {
+        readLines(openingBookFile);
+    }
+
+    mLogger << LogLevel::Info << "Book contains " << mPositions.size() << " positions and " << mMoves.size()
+            << " moves" << Flush;
+}
+
+OpeningBook::~OpeningBook()
+{
+    if (mMapping)
+        munmap(mMapping, mMappingLength);
+}
+
+// Nothing is read until a lookup touches it, so even a huge book loads instantly
+bool OpeningBook::map(const std::string& path)
+{
+    const int file = open(path.c_str(), O_RDONLY);
+    struct stat status{};
+    if (file < 0 || fstat(file, &status) != 0 || static_cast<std::size_t>(status.st_size) < sizeof(BookHeader))
+    {
+        mLogger << LogLevel::Error << "Couldn't read opening book " << path << Flush;
+        if (file >= 0)
+            close(file);
+        return false;
+    }
+
+    const auto length = static_cast<std::size_t>(status.st_size);
+    void* mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file); // The mapping keeps the file open for itself
+    if (mapping == MAP_FAILED)
+    {
+        mLogger << LogLevel::Error << "Couldn't map opening book " << path << Flush;
+        return false;
+    }
+
+    mMapping = mapping;
+    mMappingLength = length;
+
+    const auto* bytes = static_cast<const std::byte*>(mapping);
+    const auto* header = reinterpret_cast<const BookHeader*>(bytes);
+    const auto positionBytes = header->mPositionCount * sizeof(BookPosition);
+    if (length != sizeof(BookHeader) + positionBytes + header->mMoveCount * sizeof(BookMove))
+    {
+        mLogger << LogLevel::Error << "Opening book " << path << " is the wrong length for its header" << Flush;
+        return false;
+    }
+
+    mSize = header->mSize;
+    mKomi = header->mKomi;
+    mPositions = {reinterpret_cast<const BookPosition*>(bytes + sizeof(BookHeader)), header->mPositionCount};
+    mMoves = {reinterpret_cast<const BookMove*>(bytes + sizeof(BookHeader) + positionBytes), header->mMoveCount};
+    return true;
+}
+
+void OpeningBook::readLines(const std::string& path)
+{
     // TODO: Obviously we don't want to hardcode board size
-    std::size_t boardSize = 6;
-    std::ifstream fileStream(openingBookFile);
+    mSize = 6;
+    mAnyKomi = true;
+    OpeningBookBuilder builder(mSize);
+    std::ifstream fileStream(path);
 
     int openingsLoaded = 0;
     std::string line;
     while (getline(fileStream, line))
     {
-        auto moves = split(line, ' ');
-        if (moves.empty())
+        if (split(line, ' ').empty())
             continue;
 
-        Game game(boardSize); // Komi doesn't matter here yet
-        for (const auto& move : moves)
-        {
-            Position position = game.getPosition();
-            Shift canonicalShift = position.getCanonicalShift();
-            Position canonicalPosition = position.shift(canonicalShift);
-
-            PtnTurn ptnTurn(move);
-            auto moveIndex = calcMoveIndex(ptnTurn.mRank, ptnTurn.mCol, boardSize);
-            auto canonicalMoveIndex = applyShift(moveIndex, boardSize, canonicalShift);
-
-            StoneType stoneType = ptnTurn.mPlacedStoneType;
-            Move canonicalResponse = Move(canonicalMoveIndex, ptnTurn.mPlacedStoneType);
-
-            bool moveIsValid = false;
-            for (const auto response : canonicalPosition.generateMoves())
-            {
-                if (response == canonicalResponse)
-                {
-                    moveIsValid = true;
-                    break;
-                }
-            }
-            assert(moveIsValid);
-
-            mOpeningTable[canonicalPosition].push_back(canonicalResponse);
-
-            game.play(move);
-        }
-
+        if (!builder.addLine(line))
+            mLogger << LogLevel::Warn << "Illegal move in opening line " << line << Flush;
         openingsLoaded++;
     }
 
+    builder.compile(mCompiledPositions, mCompiledMoves);
+    mPositions = mCompiledPositions;
+    mMoves = mCompiledMoves;
     mLogger << LogLevel::Info << "Loaded " << openingsLoaded << " opening lines from file" << Flush;
-    mLogger << LogLevel::Info << "Book contains " << mOpeningTable.size() << " positions" << Flush;
+}
+
+const BookPosition* OpeningBook::find(const Position& position) const
+{
+    if (position.size() != mSize || (!mAnyKomi && std::lround(position.getKomi() * 2) != mKomi))
+        return nullptr;
+
+    const auto hash = OpeningBook::hash(position);
+    auto found = std::lower_bound(mPositions.begin(), mPositions.end(), hash,
+                                  [](const BookPosition& entry, uint64_t hash) { return entry.mHash < hash; });
+    if (found == mPositions.end() || found->mHash != hash ||
+        static_cast<std::size_t>(found->mFirstMove) + found->mMoveCount > mMoves.size())
+        return nullptr;
+
+    return &*found;
+}
+
+std::span<const BookMove> OpeningBook::getResponses(const Position& position) const
+{
+    const auto* entry = find(position);
+    return entry ? mMoves.subspan(entry->mFirstMove, entry->mMoveCount) : std::span<const BookMove>();
+}
+
+const BookMove& OpeningBook::select(std::span<const BookMove> responses, BookSelection selection, Xoshiro256& random)
+{
+    assert(!responses.empty());
+    if (selection == BookSelection::BestScore)
+    {
+        auto adjustedScore = [](const BookMove& move)
+        { return (move.mScore * static_cast<float>(move.mWeight) + 0.5f) / static_cast<float>(move.mWeight + 1); };
+        return *std::max_element(responses.begin(), responses.end(), [&](const BookMove& a, const BookMove& b)
+                                 { return adjustedScore(a) < adjustedScore(b); });
+    }
+
+    uint64_t totalWeight = 0;
+    for (const auto& response : responses)
+        totalWeight += response.mWeight;
+
+    // Built books never have unplayed moves, but a corrupt one could, and we'd rather not divide by zero
+    if (totalWeight == 0)
+        return responses[random() % responses.size()];
+
+    uint64_t pick = random() % totalWeight;
+    for (const auto& response : responses)
+    {
+        if (pick < response.mWeight)
+            return response;
+        pick -= response.mWeight;
+    }
+    return responses.back();
 }
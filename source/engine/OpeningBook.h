@@ -1,30 +1,111 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
 #include "log/Logger.h"
+#include "other/Xoshiro.h"
+#include "tak/Move.h"
 #include "tak/Position.h"
 
-using OpeningTable = std::unordered_map<Position, MoveBuffer>;
+// A move from a book position, with how often it was played there and how those games went for whoever played it
+struct BookMove
+{
+    Move mMove;
+    uint32_t mWeight;
+    float mScore; // 1 if every game was won, 0.5 if we don't know
+};
+
+// Books keep their positions sorted by mHash, each owning mMoveCount moves from mFirstMove
+struct BookPosition
+{
+    uint64_t mHash;
+    uint32_t mFirstMove;
+    uint32_t mMoveCount;
+};
+
+static_assert(sizeof(BookMove) == 16 && sizeof(BookPosition) == 16); // Compiled books hold them just as they are here
+
+// How we pick between a book position's moves
+enum class BookSelection : uint8_t
+{
+    Weighted, // At random in proportion to how often each was played, so a book of lines picks between them evenly
+    BestScore // The one whose games went best, counting an extra draw so one lucky win doesn't beat a proven move
+};
+
+// Counts the moves played from each canonical position, to compile into a book
+class OpeningBookBuilder
+{
+    struct Tally
+    {
+        Move mMove;
+        uint32_t mWeight;
+        double mScoreSum;
+    };
+
+    std::size_t mSize;
+    double mKomi;
+    std::unordered_map<uint64_t, std::vector<Tally>> mPositions;
 
-// We read a file containing openings
-// We populate our hash table with all the next moves for a given position
-// There is no real need for this to be efficient
+public:
+    OpeningBookBuilder(std::size_t size, double komi = 0);
+
+    // The position can be any way round, we add it and the move as they are in the canonical position
+    void add(const Position& position, const Move& move, float score = 0.5f);
+    bool addLine(const std::string& line); // Moves from the start separated by spaces, false if one isn't legal
+    void merge(const OpeningBookBuilder& other); // Adds other's tallies to ours, so threads can each build their own
+    void prune(uint32_t minWeight); // Drops moves played fewer times than minWeight, and positions left with none
+
+    std::size_t positionCount() const
+    {
+        return mPositions.size();
+    }
+    void compile(std::vector<BookPosition>& positions, std::vector<BookMove>& moves) const;
+    bool write(const std::string& path) const;
+};
+
+// Moves for canonical positions, from a compiled book we mmap, or lines of moves as in Openings.txt which we compile
+// as we read them. Compiled books are a header, the BookPositions then the BookMoves, in this machine's byte order
+// Positions are keyed on a 64 bit hash alone, so callers should still check a move is legal before playing it
 class OpeningBook
 {
     Logger mLogger{"Openings"};
-    OpeningTable mOpeningTable;
+    std::size_t mSize{0};
+    int mKomi{0};           // In half points
+    bool mAnyKomi{false};   // Lines of moves don't say which komi they're for
+    void* mMapping{nullptr};
+    std::size_t mMappingLength{0};
+    std::vector<BookPosition> mCompiledPositions; // Only for lines of moves
+    std::vector<BookMove> mCompiledMoves;
+    std::span<const BookPosition> mPositions;
+    std::span<const BookMove> mMoves;
+
+    bool map(const std::string& path);
+    void readLines(const std::string& path);
+    const BookPosition* find(const Position& position) const;
 
 public:
+    OpeningBook() = default;
     explicit OpeningBook(const std::string& openingBookFile);
+    ~OpeningBook();
+    OpeningBook(const OpeningBook&) = delete;
+    OpeningBook& operator=(const OpeningBook&) = delete;
+
+    // std::hash makes no promises between standard libraries, and books outlive builds, so they have their own
+    static uint64_t hash(const Position& position);
+
     bool contains(const Position& position) const
     {
-        return mOpeningTable.contains(position);
+        return find(position) != nullptr;
     }
-    MoveBuffer getResponses(const Position& position) const
+    std::span<const BookMove> getResponses(const Position& position) const; // Empty if the book doesn't know it
+    static const BookMove& select(std::span<const BookMove> responses, BookSelection selection, Xoshiro256& random);
+    std::size_t positionCount() const
     {
-        return mOpeningTable.at(position);
+        return mPositions.size();
     }
-    OpeningBook() = default;
 };
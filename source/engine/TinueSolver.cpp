@@ -0,0 +1,208 @@
+#include "TinueSolver.h"
+#include "EndgameSolver.h"
+#include "other/Time.h"
+#include "tak/Result.h"
+
+#include <algorithm>
+#include <functional>
+
+static constexpr uint32_t infiniteProof = 1 << 30; // Big enough to never reach by adding up real proof numbers
+
+static uint32_t addProofs(uint32_t lhs, uint32_t rhs)
+{
+    return std::min(lhs + rhs, infiniteProof);
+}
+
+TinueSolver::TinueSolver(std::size_t tableSize, std::size_t nodeBudget, int maxPly)
+    : mTable(tableSize), mNodeBudget(nodeBudget), mMaxPly(maxPly)
+{
+}
+
+// Reading the clock every node would cost more than the node, so we only look every so often
+bool TinueSolver::outOfBudget()
+{
+    if (mNodes >= mNodeBudget)
+        mOutOfBudget = true;
+
+    if (mStopSearchingTime && mNodes >= mNextClockCheck)
+    {
+        mNextClockCheck = mNodes + 256;
+        if (timeInMics() >= mStopSearchingTime)
+            mOutOfBudget = true;
+    }
+    return mOutOfBudget;
+}
+
+TinueSolver::Record TinueSolver::lookup(const Position& position) const
+{
+    auto hash = std::hash<Position>{}(position) ^ mSalt;
+    const auto& record = mTable[hash % mTable.size()];
+    if (record.mHash == hash)
+        return record;
+
+    return {0, 1, 1, Move()};
+}
+
+void TinueSolver::store(const Position& position, uint32_t proof, uint32_t disproof, Move move)
+{
+    auto hash = std::hash<Position>{}(position) ^ mSalt;
+    mTable[hash % mTable.size()] = {hash, proof, disproof, move};
+}
+
+// Finished games and roads in one are already decided, anything else is a single unexplored leaf
+TinueSolver::Record TinueSolver::evaluateLeaf(const Position& position)
+{
+    const Record proven{0, 0, infiniteProof, Move()};
+    const Record disproven{0, infiniteProof, 0, Move()};
+
+    Record record{0, 1, 1, Move()};
+    auto result = position.checkResult();
+    if (result != Result::None)
+    {
+        bool blackWon = result != Result::Draw && (result & StoneBits::Black);
+        bool attackerWon = result != Result::Draw && blackWon == (mAttacker == Player::Black);
+        record = attackerWon ? proven : disproven;
+    }
+    else if (position.hasRoadInOne(position.getPlayer()))
+    {
+        record = position.getPlayer() == mAttacker ? proven : disproven;
+    }
+
+    store(position, record.mProof, record.mDisproof);
+    return record;
+}
+
+// The attacker only plays moves which leave them a road in one, the defender only moves which might block every road
+// or which end the game on flats before the road can be made
+MoveBuffer TinueSolver::generateChildren(const Position& position) const
+{
+    if (position.getPlayer() != mAttacker)
+    {
+        MoveBuffer defences = position.generateBlocks(position.findWinningMoves(mAttacker));
+        if (EndgameSolver::canEndOnFlats(position))
+        {
+            for (const auto& move : position.generateMoves())
+            {
+                Position nextPosition(position);
+                nextPosition.play(move);
+                if (nextPosition.checkResult() != Result::None &&
+                    std::find(defences.begin(), defences.end(), move) == defences.end())
+                    defences.push_back(move);
+            }
+        }
+        return defences;
+    }
+
+    MoveBuffer threats = position.generateMoves();
+    std::erase_if(threats, [&](const Move& move) {
+        Position nextPosition(position);
+        nextPosition.play(move);
+        return !nextPosition.hasRoadInOne(mAttacker);
+    });
+
+    return threats;
+}
+
+// Standard df-pn: phi is the work needed to show the player to move wins, delta to show they don't
+// We keep expanding the most proving child until this position's numbers pass the thresholds our parent gave us
+void TinueSolver::search(const Position& position, uint32_t proofThreshold, uint32_t disproofThreshold, int ply)
+{
+    ++mNodes;
+    const bool attacking = position.getPlayer() == mAttacker;
+    const uint32_t phiThreshold = attacking ? proofThreshold : disproofThreshold;
+    const uint32_t deltaThreshold = attacking ? disproofThreshold : proofThreshold;
+
+    const MoveBuffer moves = generateChildren(position);
+    std::vector<Position> children(moves.size(), position);
+    for (std::size_t index = 0; index < moves.size(); ++index)
+        children[index].play(moves[index]);
+
+    while (true)
+    {
+        uint32_t phi = infiniteProof;
+        uint32_t delta = 0;
+        uint32_t secondBestDelta = infiniteProof;
+        uint32_t bestChildPhi = 0;
+        std::size_t bestIndex = 0;
+
+        for (std::size_t index = 0; index < children.size(); ++index)
+        {
+            auto record = lookup(children[index]);
+            if (record.mHash == 0)
+                record = evaluateLeaf(children[index]);
+
+            // We don't search children past mMaxPly, so one still undecided can only count as no tinue, for this node
+            // alone. Storing that as the child's disproof would let it stand wherever the child turns up shallower
+            if (ply + 1 >= mMaxPly && record.mProof != 0 && record.mDisproof != 0)
+            {
+                record.mProof = infiniteProof;
+                record.mDisproof = 0;
+                mHitMaxPly = true;
+            }
+
+            // Each child has the other player to move, so its phi and delta are the other way round to ours
+            uint32_t childPhi = attacking ? record.mDisproof : record.mProof;
+            uint32_t childDelta = attacking ? record.mProof : record.mDisproof;
+
+            delta = addProofs(delta, childPhi);
+            if (childDelta < phi)
+            {
+                secondBestDelta = phi;
+                phi = childDelta;
+                bestChildPhi = childPhi;
+                bestIndex = index;
+            }
+            else if (childDelta < secondBestDelta)
+            {
+                secondBestDelta = childDelta;
+            }
+        }
+
+        if (phi >= phiThreshold || delta >= deltaThreshold || outOfBudget())
+        {
+            Move provingMove = (attacking && phi == 0) ? moves[bestIndex] : Move();
+            store(position, attacking ? phi : delta, attacking ? delta : phi, provingMove);
+            if (ply == 0)
+                mRoot = {0, attacking ? phi : delta, attacking ? delta : phi, provingMove};
+            return;
+        }
+
+        uint32_t childPhiThreshold = std::min(deltaThreshold - (delta - bestChildPhi), infiniteProof);
+        uint32_t childDeltaThreshold = std::min(phiThreshold, secondBestDelta + 1);
+        if (attacking)
+            search(children[bestIndex], childDeltaThreshold, childPhiThreshold, ply + 1);
+        else
+            search(children[bestIndex], childPhiThreshold, childDeltaThreshold, ply + 1);
+    }
+}
+
+TinueResult TinueSolver::solve(const Position& position, int64_t stopSearchingTime)
+{
+    mNodes = 0;
+    mStopSearchingTime = stopSearchingTime;
+    mOutOfBudget = false;
+    mHitMaxPly = false;
+    mNextClockCheck = 0;
+    mAttacker = position.getPlayer();
+    mSalt += 0x9e3779b97f4a7c15;
+    mRoot = {0, 1, 1, Move()};
+
+    if (position.checkResult() != Result::None)
+        return {TinueStatus::NoTinue, Move(), 0};
+
+    auto roads = position.findWinningMoves(mAttacker);
+    if (!roads.empty())
+        return {TinueStatus::Tinue, roads.front(), 0};
+
+    search(position, infiniteProof, infiniteProof, 0);
+
+    TinueResult result{TinueStatus::Unknown, Move(), mNodes};
+    if (mRoot.mProof == 0 && isSet(mRoot.mMove))
+        result = {TinueStatus::Tinue, mRoot.mMove, mNodes};
+    else if (mRoot.mDisproof == 0 && !mHitMaxPly)
+        result = {TinueStatus::NoTinue, Move(), mNodes};
+
+    mLogger << LogLevel::Info << "Tinue search finished after " << mNodes << " nodes with proof " << mRoot.mProof
+            << " and disproof " << mRoot.mDisproof << (mHitMaxPly ? ", cut off at the ply limit" : "") << Flush;
+    return result;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "log/Logger.h"
+#include "tak/Move.h"
+#include "tak/Player.h"
+#include "tak/Position.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum class TinueStatus : uint8_t
+{
+    Unknown, // We ran out of nodes or plies before we could prove it either way
+    Tinue,   // The player to move can make a road however their opponent defends
+    NoTinue  // There's no road we can force using only threats
+};
+
+struct TinueResult
+{
+    TinueStatus mStatus;
+    Move mMove;         // Only set for TinueStatus::Tinue, the first move of the tinue
+    std::size_t mNodes; // How many positions did we expand?
+};
+
+// A depth first proof number (df-pn) search for tinue, a road the player to move can force whatever their opponent does
+// The attacker only plays moves which threaten a road next turn, and the defender only plays moves which might block
+// every threat, so the tree stays narrow enough to search far deeper than negamax can
+class TinueSolver
+{
+    struct Record
+    {
+        uint64_t mHash;
+        uint32_t mProof;    // How many more leaves do we need to prove to show tinue?
+        uint32_t mDisproof; // How many more leaves do we need to disprove to show there's none?
+        Move mMove;         // Which move proved it, for positions the attacker plays from
+    };
+
+    Logger mLogger{"Tinue"};
+    std::vector<Record> mTable;
+    std::size_t mNodeBudget;
+    int mMaxPly;
+    std::size_t mNodes{0};
+    int64_t mStopSearchingTime{0}; // Zero for no deadline
+    bool mOutOfBudget{false};
+    bool mHitMaxPly{false};        // Lines cut off there only count as no tinue, so we can't claim there is none
+    std::size_t mNextClockCheck{0};
+    uint64_t mSalt{0};             // XORed into every hash, so a solve misses older solves' records without clearing
+    Player mAttacker{Player::White};
+    Record mRoot;                  // Another position could overwrite it in the table, mHash isn't set
+
+    bool outOfBudget();
+    Record lookup(const Position& position) const;
+    void store(const Position& position, uint32_t proof, uint32_t disproof, Move move = Move());
+    Record evaluateLeaf(const Position& position);
+
+    MoveBuffer generateChildren(const Position& position) const;
+    void search(const Position& position, uint32_t proofThreshold, uint32_t disproofThreshold, int ply);
+
+public:
+    static constexpr std::size_t sDefaultTableSize = 1 << 18; // 256 thousand entries * 24 bytes = 6 Megs
+    static constexpr int sDefaultMaxPly = 30;
+
+    explicit TinueSolver(std::size_t tableSize = sDefaultTableSize, std::size_t nodeBudget = 20000,
+                         int maxPly = sDefaultMaxPly);
+
+    TinueResult solve(const Position& position, int64_t stopSearchingTime = 0);
+};
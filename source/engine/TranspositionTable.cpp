@@ -3,7 +3,7 @@
 std::optional<TranspositionTableRecord> TranspositionTable::fetch(const Position& position, std::size_t depth) const
 {
     auto hash = std::hash<Position>{}(position);
-    auto record = (*mTable)[hash % sTableSize];
+    auto record = mTable[hash % mTable.size()];
 
     if (record.mHash == hash && record.mDepth >= depth)
     {
@@ -16,7 +16,7 @@ std::optional<TranspositionTableRecord> TranspositionTable::fetch(const Position
 void TranspositionTable::store(const Position& position, Move move, int score, uint8_t depth, ResultType type)
 {
     auto hash = std::hash<Position>{}(position);
-    auto& record = (*mTable)[hash % sTableSize];
+    auto& record = mTable[hash % mTable.size()];
 
     if (record.mHash == hash && record.mDepth >= depth)
         return;
@@ -27,7 +27,7 @@ void TranspositionTable::store(const Position& position, Move move, int score, u
 std::size_t TranspositionTable::count() const
 {
     std::size_t entryCount = 0;
-    for (const auto& entry : *mTable)
+    for (const auto& entry : mTable)
     {
         if (entry.mHash != 0)
             entryCount++;
@@ -7,6 +7,7 @@
 
 #include <optional>
 #include <unordered_map>
+#include <vector>
 
 enum ResultType : uint8_t
 {
@@ -36,23 +37,16 @@ struct TranspositionTableRecord
 class TranspositionTable
 {
     Logger mLogger{"Engine"};
-    static constexpr std::size_t sTableSize = 1 << 22; // 4 million entries * 24 bytes = 64 Megs
-
-    using TableT = std::array<TranspositionTableRecord, sTableSize>;
-    TableT* mTable;
+    std::vector<TranspositionTableRecord> mTable;
 
 public:
-    TranspositionTable()
-    {
-        mTable = new TableT{};
-    }
+    static constexpr std::size_t sDefaultTableSize = 1 << 22; // 4 million entries * 24 bytes = 96 Megs
 
-    ~TranspositionTable()
+    // Searches which never use the table, like MonteCarlo's leaf searches, can make do with a single entry
+    explicit TranspositionTable(std::size_t tableSize = sDefaultTableSize) : mTable(tableSize)
     {
-        delete mTable;
     }
 
-public:
     std::optional<TranspositionTableRecord> fetch(const Position& position, std::size_t depth) const;
     void store(const Position& position, Move move, int score, uint8_t depth, ResultType type);
 
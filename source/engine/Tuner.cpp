@@ -0,0 +1,183 @@
+#include "Tuner.h"
+
+#include <cmath>
+#include <numeric>
+
+void addTuningPositions(const Game& game, std::vector<TuningPosition>& positions)
+{
+    // Games which were resigned or lost on time only have their result in the PTN
+    Result result = game.getPtnResult() != Result::None ? game.getPtnResult() : game.checkResult();
+    if (result == Result::None)
+        return;
+
+    float target = result == Result::Draw ? 0.5f : (result & StoneBits::Black) ? 0.0f : 1.0f;
+
+    Position position(game.getPosition().size(), game.getPosition().getKomi());
+    for (const auto& move : game.getMoveList())
+    {
+        position.play(move);
+        if (position.checkResult() != Result::None)
+            break;
+
+        if (!position.hasRoadInOne(Player::White) && !position.hasRoadInOne(Player::Black))
+            positions.push_back(TuningPosition{evaluationFeatures(position), target});
+    }
+}
+
+Tuner::Tuner(const std::vector<TuningPosition>& positions, std::size_t threadCount)
+    : mPositions(positions), mThreadCount(std::max<std::size_t>(threadCount, 1))
+{
+}
+
+Tuner::Weights Tuner::toVector(const EvaluationWeights& weights)
+{
+    Weights vector{};
+    for (std::size_t index = 0; index < gEvaluationWeightFields.size(); ++index)
+        vector[index] = weights.*gEvaluationWeightFields[index].mWeight;
+    return vector;
+}
+
+EvaluationWeights Tuner::fromVector(const Weights& weights)
+{
+    EvaluationWeights rounded{};
+    for (std::size_t index = 0; index < gEvaluationWeightFields.size(); ++index)
+        rounded.*gEvaluationWeightFields[index].mWeight = static_cast<int>(std::lround(weights[index]));
+    return rounded;
+}
+
+double Tuner::lossAndGradient(const Weights& weights, Weights* gradient) const
+{
+    std::vector<double> losses(mThreadCount, 0.0);
+    std::vector<Weights> gradients(mThreadCount, Weights{});
+
+    auto work = [&](std::size_t thread)
+    {
+        const std::size_t begin = mPositions.size() * thread / mThreadCount;
+        const std::size_t end = mPositions.size() * (thread + 1) / mThreadCount;
+        double threadLoss = 0;
+        Weights& threadGradient = gradients[thread];
+
+        for (std::size_t index = begin; index < end; ++index)
+        {
+            const TuningPosition& position = mPositions[index];
+            double score = 0;
+            for (std::size_t field = 0; field < weights.size(); ++field)
+                score += weights[field] * position.mFeatures[field];
+
+            // Clamped so a confident wrong prediction costs a lot rather than infinity
+            const double predicted = std::clamp(1 / (1 + std::exp(-mScale * score)), 1e-9, 1 - 1e-9);
+            threadLoss -= position.mResult * std::log(predicted) + (1 - position.mResult) * std::log(1 - predicted);
+
+            if (gradient)
+            {
+                const double error = (predicted - position.mResult) * mScale;
+                for (std::size_t field = 0; field < weights.size(); ++field)
+                    threadGradient[field] += error * position.mFeatures[field];
+            }
+        }
+        losses[thread] = threadLoss;
+    };
+
+    std::vector<std::thread> threads;
+    for (std::size_t thread = 1; thread < mThreadCount; ++thread)
+        threads.emplace_back(work, thread);
+    work(0);
+    for (auto& thread : threads)
+        thread.join();
+
+    const double count = std::max<std::size_t>(mPositions.size(), 1);
+    if (gradient)
+    {
+        *gradient = Weights{};
+        for (const auto& threadGradient : gradients)
+        {
+            for (std::size_t field = 0; field < gradient->size(); ++field)
+                (*gradient)[field] += threadGradient[field] / count;
+        }
+    }
+
+    return std::accumulate(losses.begin(), losses.end(), 0.0) / count;
+}
+
+double Tuner::loss(const Weights& weights) const
+{
+    return lossAndGradient(weights, nullptr);
+}
+
+double Tuner::loss(const EvaluationWeights& weights) const
+{
+    return loss(toVector(weights));
+}
+
+double Tuner::fitScale(const EvaluationWeights& weights)
+{
+    const Weights vector = toVector(weights);
+    auto lossWithScale = [&](double logScale)
+    {
+        mScale = std::exp(logScale);
+        return loss(vector);
+    };
+
+    // Coarse steps first, as the loss isn't always convex far from the minimum, then a ternary search between them
+    constexpr double step = 0.5;
+    double bestLogScale = std::log(1e-5);
+    double bestLoss = lossWithScale(bestLogScale);
+    for (double logScale = bestLogScale + step; logScale <= 0; logScale += step)
+    {
+        const double scaleLoss = lossWithScale(logScale);
+        if (scaleLoss < bestLoss)
+        {
+            bestLoss = scaleLoss;
+            bestLogScale = logScale;
+        }
+    }
+
+    double low = bestLogScale - step;
+    double high = bestLogScale + step;
+    for (int iteration = 0; iteration < 30; ++iteration)
+    {
+        const double lowThird = low + (high - low) / 3;
+        const double highThird = high - (high - low) / 3;
+        if (lossWithScale(lowThird) < lossWithScale(highThird))
+            high = highThird;
+        else
+            low = lowThird;
+    }
+
+    mScale = std::exp((low + high) / 2);
+    mLogger << LogLevel::Info << "Fitted scale " << mScale << " with loss " << loss(vector) << Flush;
+    return mScale;
+}
+
+Tuner::Weights Tuner::tune(const EvaluationWeights& start, std::size_t epochs, double learningRate)
+{
+    constexpr double beta1 = 0.9;
+    constexpr double beta2 = 0.999;
+    constexpr double epsilon = 1e-8;
+
+    Weights weights = toVector(start);
+    Weights momentum{};
+    Weights velocity{};
+    Weights gradient{};
+
+    for (std::size_t epoch = 1; epoch <= epochs; ++epoch)
+    {
+        const double epochLoss = lossAndGradient(weights, &gradient);
+        if (epoch == 1 || epoch % 100 == 0)
+            mLogger << LogLevel::Info << "Epoch " << epoch << " loss " << epochLoss << Flush;
+
+        const double momentumCorrection = 1 - std::pow(beta1, epoch);
+        const double velocityCorrection = 1 - std::pow(beta2, epoch);
+        for (std::size_t field = 0; field < weights.size(); ++field)
+        {
+            momentum[field] = beta1 * momentum[field] + (1 - beta1) * gradient[field];
+            velocity[field] = beta2 * velocity[field] + (1 - beta2) * gradient[field] * gradient[field];
+            const double step = (momentum[field] / momentumCorrection) /
+                                (std::sqrt(velocity[field] / velocityCorrection) + epsilon);
+            weights[field] -= learningRate * step;
+        }
+    }
+
+    mLogger << LogLevel::Info << "Finished with loss " << loss(weights) << Flush;
+    return weights;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "Engine.h"
+#include "log/Logger.h"
+#include "tak/Game.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Just what tuning needs from a position, so millions of them fit in memory and an epoch is one pass over an array
+struct TuningPosition
+{
+    EvaluationFeatures mFeatures;
+    float mResult; // 1 for a white win, 0.5 for a draw and 0 for a black win
+};
+
+// Adds the quiet positions of a finished game, those not over yet and with no road in one for either player,
+// as a search would take their static evaluation at face value
+void addTuningPositions(const Game& game, std::vector<TuningPosition>& positions);
+
+// Texel style tuning: predict each game's result as sigmoid(scale * evaluation), and minimise the log loss of those
+// predictions over the weights by gradient descent, with the positions split between threads
+class Tuner
+{
+public:
+    using Weights = std::array<double, gEvaluationWeightFields.size()>;
+
+private:
+    Logger mLogger{"Tuner"};
+    const std::vector<TuningPosition>& mPositions;
+    std::size_t mThreadCount;
+    double mScale{0.01};
+
+    // The loss, and its gradient if given one, summed over the positions by every thread
+    double lossAndGradient(const Weights& weights, Weights* gradient) const;
+
+public:
+    explicit Tuner(const std::vector<TuningPosition>& positions,
+                   std::size_t threadCount = std::max(1u, std::thread::hardware_concurrency()));
+
+    static Weights toVector(const EvaluationWeights& weights);
+    static EvaluationWeights fromVector(const Weights& weights); // Rounded, as evaluate uses ints
+
+    // Picks the scale that best predicts the results with the given weights, which stay fixed while tuning
+    double fitScale(const EvaluationWeights& weights);
+
+    double loss(const Weights& weights) const; // Mean log loss per position
+    double loss(const EvaluationWeights& weights) const;
+
+    // Adam from the given weights, logging the loss every so often
+    Weights tune(const EvaluationWeights& start, std::size_t epochs, double learningRate = 0.05);
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// A whole file mapped read only, so reading it is reading memory and the kernel pages it in as we go
+// getText is empty if the file couldn't be opened, which for our uses is as good as an empty file
+class MappedFile
+{
+    void* mMapping{nullptr};
+    std::size_t mLength{0};
+
+public:
+    explicit MappedFile(const std::string& path)
+    {
+        const int file = open(path.c_str(), O_RDONLY);
+        if (file < 0)
+            return;
+
+        struct stat status{};
+        if (fstat(file, &status) == 0 && status.st_size > 0)
+        {
+            const auto length = static_cast<std::size_t>(status.st_size);
+            void* mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, file, 0);
+            if (mapping != MAP_FAILED)
+            {
+                madvise(mapping, length, MADV_SEQUENTIAL);
+                mMapping = mapping;
+                mLength = length;
+            }
+        }
+        close(file); // The mapping keeps the file open for itself
+    }
+    ~MappedFile()
+    {
+        if (mMapping)
+            munmap(mMapping, mLength);
+    }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::string_view getText() const
+    {
+        return {static_cast<const char*>(mMapping), mLength};
+    }
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <limits>
+
+// xoshiro256** (https://prng.di.unimi.it), a few adds, shifts and rotates per number
+// Much quicker than std::default_random_engine, and plenty random enough for playouts
+class Xoshiro256
+{
+    std::array<uint64_t, 4> mState;
+
+    static uint64_t rotateLeft(uint64_t value, int bits)
+    {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+public:
+    using result_type = uint64_t;
+
+    // The state mustn't be all zeroes, so it's filled from the seed by splitmix64 as the authors recommend
+    explicit Xoshiro256(uint64_t seed)
+    {
+        for (auto& word : mState)
+        {
+            seed += 0x9e3779b97f4a7c15;
+            uint64_t mixed = seed;
+            mixed = (mixed ^ (mixed >> 30)) * 0xbf58476d1ce4e5b9;
+            mixed = (mixed ^ (mixed >> 27)) * 0x94d049bb133111eb;
+            word = mixed ^ (mixed >> 31);
+        }
+    }
+
+    static constexpr result_type min()
+    {
+        return 0;
+    }
+    static constexpr result_type max()
+    {
+        return std::numeric_limits<result_type>::max();
+    }
+
+    result_type operator()()
+    {
+        const uint64_t result = rotateLeft(mState[1] * 5, 7) * 9;
+        const uint64_t shifted = mState[1] << 17;
+
+        mState[2] ^= mState[0];
+        mState[3] ^= mState[1];
+        mState[1] ^= mState[2];
+        mState[0] ^= mState[3];
+        mState[2] ^= shifted;
+        mState[3] = rotateLeft(mState[3], 45);
+
+        return result;
+    }
+
+    // A number in [0, bound), by multiplying rather than the slow modulo, with a bias too small to matter here
+    uint32_t below(uint32_t bound)
+    {
+        return static_cast<uint32_t>(((*this)() >> 32) * bound >> 32);
+    }
+};
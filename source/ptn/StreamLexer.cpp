@@ -0,0 +1,162 @@
+#include "StreamLexer.h"
+
+#include <algorithm>
+
+static bool isSpace(char c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f';
+}
+
+static bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+static bool isFile(char c)
+{
+    return c >= 'a' && c <= 'h';
+}
+
+static bool isRank(char c)
+{
+    return c >= '1' && c <= '8';
+}
+
+static bool isStone(char c)
+{
+    return c == 'C' || c == 'S' || c == 'F';
+}
+
+static bool isWordCharacter(char c)
+{
+    return isDigit(c) || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+// Sets mIndex to end and returns mValue as length characters from start
+TokenView StreamLexer::take(TokenType type, std::size_t start, std::size_t length, std::size_t end)
+{
+    mIndex = end;
+    return TokenView{type, mText.substr(start, length)};
+}
+
+// 1/2-1/2, or R-0, 0-F, 1-0 and so on, returning its length or zero if there isn't one at mIndex
+std::size_t StreamLexer::matchResult() const
+{
+    const auto rest = mText.substr(mIndex);
+    if (rest.starts_with("1/2-1/2"))
+        return 7;
+
+    auto isResult = [](char c) { return c == 'R' || c == 'F' || c == '1' || c == '0'; };
+    return rest.size() >= 3 && isResult(rest[0]) && rest[1] == '-' && isResult(rest[2]) ? 3 : 0;
+}
+
+// The digits of a number followed by a dot
+std::size_t StreamLexer::matchPlyNum() const
+{
+    std::size_t end = mIndex;
+    while (end < mText.size() && isDigit(mText[end]))
+        ++end;
+    return end != mIndex && mText[mIndex] != '0' && end < mText.size() && mText[end] == '.' ? end - mIndex : 0;
+}
+
+// Cc3 or a1'! for placements, 5a2>1121* or c3<C for spreads, which must end at whitespace or the end of the text
+std::size_t StreamLexer::matchMove(TokenType& type) const
+{
+    auto at = [&](std::size_t index) { return index < mText.size() ? mText[index] : '\0'; };
+    std::size_t end = mIndex;
+    const bool stone = isStone(at(end));
+    const bool count = isRank(at(end));
+    if (stone || count)
+        ++end;
+
+    if (!isFile(at(end)) || !isRank(at(end + 1)))
+        return 0;
+    end += 2;
+
+    const char direction = at(end);
+    if (direction == '+' || direction == '-' || direction == '<' || direction == '>')
+    {
+        if (stone)
+            return 0;
+
+        ++end;
+        while (isRank(at(end)))
+            ++end;
+        if (isStone(at(end)))
+            ++end;
+        if (at(end) == '*')
+            ++end;
+        type = TokenType::MoveMove;
+    }
+    else
+    {
+        if (count)
+            return 0;
+        type = TokenType::PlaceMove;
+    }
+
+    while (at(end) == '\'' || at(end) == '!' || at(end) == '?')
+        ++end;
+    return end == mText.size() || isSpace(mText[end]) ? end - mIndex : 0;
+}
+
+TokenView StreamLexer::next()
+{
+    while (true)
+    {
+        while (mIndex < mText.size() && isSpace(mText[mIndex]))
+            ++mIndex;
+        if (mIndex == mText.size())
+            return TokenView{};
+
+        const std::size_t start = mIndex;
+        const char c = mText[start];
+        if (mInTag)
+        {
+            if (c == ']')
+            {
+                mInTag = false;
+                return take(TokenType::TagClose, start, 1, start + 1);
+            }
+            if (c == '"')
+            {
+                const auto close = std::min(mText.find('"', start + 1), mText.size());
+                return take(TokenType::TagData, start + 1, close - start - 1, std::min(close + 1, mText.size()));
+            }
+            if (isWordCharacter(c))
+            {
+                std::size_t end = start + 1;
+                while (end < mText.size() && isWordCharacter(mText[end]))
+                    ++end;
+                return take(TokenType::TagKey, start, end - start, end);
+            }
+        }
+        else if (c == '[')
+        {
+            mInTag = true;
+            return take(TokenType::TagOpen, start, 1, start + 1);
+        }
+        else if (c == '{')
+        {
+            const auto close = std::min(mText.find('}', start + 1), mText.size());
+            return take(TokenType::Comment, start + 1, close - start - 1, std::min(close + 1, mText.size()));
+        }
+        else if (const auto length = matchResult())
+        {
+            return take(TokenType::GameResult, start, length, start + length);
+        }
+        else if (const auto length = matchPlyNum())
+        {
+            return take(TokenType::PlyNum, start, length, start + length + 1);
+        }
+        else
+        {
+            TokenType type;
+            if (const auto length = matchMove(type))
+                return take(type, start, length, start + length);
+        }
+
+        while (mIndex < mText.size() && !isSpace(mText[mIndex]))
+            ++mIndex;
+    }
+}
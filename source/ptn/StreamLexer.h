@@ -0,0 +1,41 @@
+#pragma once
+
+#include "Token.h"
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// A token as it appears in the PTN, pointing into the text it was read from
+struct TokenView
+{
+    TokenType mType{TokenType::End};
+    std::string_view mValue;
+
+    Token toToken() const
+    {
+        return Token{mType, std::string(mValue)};
+    }
+};
+
+// Tokenises a whole PTN text in one pass, looking at each character once rather than regex matching ever longer
+// prefixes as Lexer does. Tokens point into the text, which is usually a MappedFile and has to outlive them
+// Anything it doesn't recognise is skipped up to the next whitespace
+class StreamLexer
+{
+    std::string_view mText;
+    std::size_t mIndex{0};
+    bool mInTag{false}; // Between [ and ], where words are tag keys rather than moves
+
+    TokenView take(TokenType type, std::size_t start, std::size_t length, std::size_t end);
+    std::size_t matchResult() const;
+    std::size_t matchPlyNum() const;
+    std::size_t matchMove(TokenType& type) const;
+
+public:
+    explicit StreamLexer(std::string_view text) : mText(text)
+    {
+    }
+
+    TokenView next(); // TokenType::End once the text runs out
+};
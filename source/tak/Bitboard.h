@@ -0,0 +1,174 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Bit n of a Bitboard is Position::mBoard[n], so a1 is bit 0 and the 1 rank is the bottom edge
+using Bitboard = uint64_t;
+
+struct BoardMasks
+{
+    Bitboard mBoard;
+    Bitboard mBottom;
+    Bitboard mTop;
+    Bitboard mLeft;
+    Bitboard mRight;
+};
+
+constexpr BoardMasks makeBoardMasks(std::size_t size)
+{
+    BoardMasks masks{0, 0, 0, 0, 0};
+    for (std::size_t index = 0; index < size * size; ++index)
+    {
+        Bitboard bit = Bitboard{1} << index;
+        masks.mBoard |= bit;
+        if (index < size)
+            masks.mBottom |= bit;
+        if (index >= size * size - size)
+            masks.mTop |= bit;
+        if (index % size == 0)
+            masks.mLeft |= bit;
+        if (index % size == size - 1)
+            masks.mRight |= bit;
+    }
+    return masks;
+}
+
+// Indexed by board size, so we never have to build masks in a hot loop
+inline constexpr std::array<BoardMasks, 9> gBoardMasks = {
+    makeBoardMasks(0), makeBoardMasks(1), makeBoardMasks(2), makeBoardMasks(3), makeBoardMasks(4),
+    makeBoardMasks(5), makeBoardMasks(6), makeBoardMasks(7), makeBoardMasks(8)};
+
+// Every square from a square to the edge in each direction, not including the square itself, and how many that is
+// The directions are up, down, left and right, the same order as Directions in Direction.h
+// The lengths save a popcount, which without -mpopcnt is a library call
+struct RayTable
+{
+    std::array<std::array<Bitboard, 4>, 64> mMasks;
+    std::array<std::array<uint8_t, 4>, 64> mLengths;
+};
+
+constexpr RayTable makeRayTable(std::size_t size)
+{
+    RayTable rays{};
+    for (std::size_t index = 0; index < size * size; ++index)
+    {
+        const std::size_t row = index / size;
+        const std::size_t col = index % size;
+        for (std::size_t up = row + 1; up < size; ++up)
+            rays.mMasks[index][0] |= Bitboard{1} << (up * size + col);
+        for (std::size_t down = 0; down < row; ++down)
+            rays.mMasks[index][1] |= Bitboard{1} << (down * size + col);
+        for (std::size_t left = 0; left < col; ++left)
+            rays.mMasks[index][2] |= Bitboard{1} << (row * size + left);
+        for (std::size_t right = col + 1; right < size; ++right)
+            rays.mMasks[index][3] |= Bitboard{1} << (row * size + right);
+
+        rays.mLengths[index] = {static_cast<uint8_t>(size - 1 - row), static_cast<uint8_t>(row),
+                                static_cast<uint8_t>(col), static_cast<uint8_t>(size - 1 - col)};
+    }
+    return rays;
+}
+
+inline constexpr std::array<RayTable, 9> gRayTables = {
+    makeRayTable(0), makeRayTable(1), makeRayTable(2), makeRayTable(3), makeRayTable(4),
+    makeRayTable(5), makeRayTable(6), makeRayTable(7), makeRayTable(8)};
+
+// Every square orthogonally adjacent to a square in bitboard
+inline Bitboard adjacent(Bitboard bitboard, std::size_t size)
+{
+    const BoardMasks& masks = gBoardMasks[size];
+    Bitboard up = bitboard << size;
+    Bitboard down = bitboard >> size;
+    Bitboard left = (bitboard & ~masks.mLeft) >> 1;
+    Bitboard right = (bitboard & ~masks.mRight) << 1;
+    return (up | down | left | right) & masks.mBoard;
+}
+
+// Every square in region connected to seed through region
+inline Bitboard floodFill(Bitboard seed, Bitboard region, std::size_t size)
+{
+    seed &= region;
+    while (true)
+    {
+        Bitboard grown = (seed | adjacent(seed, size)) & region;
+        if (grown == seed)
+            return seed;
+        seed = grown;
+    }
+}
+
+// Does some square in region connected to seed through region lie in target
+inline bool floodFillReaches(Bitboard seed, Bitboard region, Bitboard target, std::size_t size)
+{
+    seed &= region;
+    while (!(seed & target))
+    {
+        Bitboard grown = (seed | adjacent(seed, size)) & region;
+        if (grown == seed)
+            return false;
+        seed = grown;
+    }
+    return true;
+}
+
+// Does some group of roadSquares connect opposite edges
+inline bool containsRoad(Bitboard roadSquares, std::size_t size)
+{
+    const BoardMasks& masks = gBoardMasks[size];
+    if ((roadSquares & masks.mBottom) && (roadSquares & masks.mTop) &&
+        floodFillReaches(roadSquares & masks.mBottom, roadSquares, masks.mTop, size))
+        return true;
+
+    return (roadSquares & masks.mLeft) && (roadSquares & masks.mRight) &&
+           floodFillReaches(roadSquares & masks.mLeft, roadSquares, masks.mRight, size);
+}
+
+// Squares on an edge, or next to a group of roadSquares which touches it
+// Any new road must contain such a square for both the edges it joins, so these make cheap road filters
+struct EdgeReach
+{
+    Bitboard mBottom;
+    Bitboard mTop;
+    Bitboard mLeft;
+    Bitboard mRight;
+
+    // Squares which would join opposite edges if they became road squares on their own
+    Bitboard joining() const { return (mBottom & mTop) | (mLeft & mRight); }
+
+    // False only if adding squares to roadSquares certainly can't make a new road
+    bool couldJoin(Bitboard squares) const
+    {
+        return ((squares & mBottom) && (squares & mTop)) || ((squares & mLeft) && (squares & mRight));
+    }
+};
+
+inline EdgeReach findEdgeReach(Bitboard roadSquares, std::size_t size)
+{
+    const BoardMasks& masks = gBoardMasks[size];
+    auto reach = [&](Bitboard edge) { return edge | adjacent(floodFill(roadSquares & edge, roadSquares, size), size); };
+    return {reach(masks.mBottom), reach(masks.mTop), reach(masks.mLeft), reach(masks.mRight)};
+}
+
+// The fewest steps squares a path from start to target has to cross, where free squares cost nothing,
+// found a wave at a time: everything reached for a cost, flood filled through free, then grown by a step
+// Stops counting past limit, returning limit + 1 for paths that long or that don't exist
+inline std::size_t waveDistance(Bitboard start, Bitboard target, Bitboard free, Bitboard steps, std::size_t limit,
+                                std::size_t size)
+{
+    Bitboard reached = floodFill(start, free, size);
+    for (std::size_t distance = 0; distance <= limit; ++distance)
+    {
+        if (reached & target)
+            return distance;
+
+        const Bitboard next = (adjacent(reached, size) | start) & steps & ~reached;
+        if (next == 0)
+            break;
+
+        reached |= next;
+        reached = floodFill(reached, reached | free, size);
+    }
+    return limit + 1;
+}
@@ -1,11 +1,10 @@
 #include "Game.h"
 
 #ifndef LOW_MEMORY_COMPILE
+#include "other/MappedFile.h"
 #include "ptn/Generator.h"
-#include "ptn/Lexer.h"
 #include "ptn/Parser.h"
-
-#include <fstream>
+#include "ptn/StreamLexer.h"
 #endif
 
 void Game::play(const std::string& ptnString)
@@ -84,24 +83,32 @@ Result Game::checkResult() const
 std::vector<Game> readGames(const std::string& ptnFilePath)
 {
     std::vector<Game> games;
-    Lexer lexer;
+    MappedFile file(ptnFilePath);
+    StreamLexer lexer(file.getText());
     Parser parser;
     Generator generator;
-    std::ifstream fileStream(ptnFilePath);
 
-    std::string line;
-    while (getline(fileStream, line))
+    // Parsed a tag or a game's moves at a time, as Parser can't carry a half read tag over to the next batch
+    std::vector<Token> tokens;
+    auto parseTokens = [&](bool flush)
     {
-        auto tokens = lexer.tokenise(line);
-        auto nodes = parser.parse(tokens);
-        auto ptnGames = generator.generate(nodes);
-        for (const auto& ptnGame : ptnGames)
+        for (const auto& ptnGame : generator.generate(parser.parse(tokens)))
             games.emplace_back(ptnGame);
+        tokens.clear();
+        if (flush)
+        {
+            for (const auto& ptnGame : generator.generate(parser.flush(), true))
+                games.emplace_back(ptnGame);
+        }
+    };
+
+    for (auto token = lexer.next(); token.mType != TokenType::End; token = lexer.next())
+    {
+        if (token.mType == TokenType::TagOpen && !tokens.empty())
+            parseTokens(false);
+        tokens.push_back(token.toToken());
     }
-    auto nodes = parser.flush();
-    auto ptnGames = generator.generate(nodes, true);
-    for (const auto& ptnGame : ptnGames)
-        games.emplace_back(ptnGame);
+    parseTokens(true);
 
     return games;
 }
@@ -39,6 +39,14 @@ public:
     {
         return mPosition;
     }
+    const std::vector<PtnTurn>& getMoveList() const
+    {
+        return mMoveList;
+    }
+    Result getPtnResult() const // The result the PTN recorded, which includes resignations and timeouts
+    {
+        return mPtnResult;
+    }
 };
 
 std::vector<Game> readGames(const std::string& ptnFilePath);
@@ -24,6 +24,11 @@ inline std::ostream& operator<<(std::ostream& stream, Player player)
     return stream;
 }
 
+inline Player opponent(Player player)
+{
+    return player == Player::White ? Player::Black : Player::White;
+}
+
 template <typename Value> struct PlayerPair
 {
     Value White;
@@ -51,6 +56,8 @@ template <typename Value> struct PlayerPair
     {
         return player == Player::White ? White : Black;
     }
+
+    bool operator==(const PlayerPair& other) const = default;
 };
 
 namespace std
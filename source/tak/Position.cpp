@@ -2,6 +2,7 @@
 
 #include "DropCountGenerator.h"
 
+#include <array>
 #include <bit>
 #include <cassert>
 #include <sstream>
@@ -31,6 +32,13 @@ void Position::initDropCountMap()
                 auto dropCounts = generateDropCounts(handSize, maxDistance, endsInSmash);
                 mDropCountMap.push_back(dropCounts);
             }
+
+    // How many spreads a stack can make in a direction, by the most it can carry, for sampleMove
+    for (std::size_t index = 0; index < mSpreadCountMap.size(); ++index)
+    {
+        const std::size_t smallerHands = index >= 16 ? mSpreadCountMap[index - 16] : 0;
+        mSpreadCountMap[index] = static_cast<uint16_t>(smallerHands + mDropCountMap[index].size());
+    }
 }
 
 void Position::initNeighbourMap()
@@ -97,6 +105,7 @@ void Position::place(const Move& place)
     bool stoneIsBlack = colour == Player::Black;
     Stone stone = stoneIsBlack ? static_cast<Stone>(place.mStoneType | StoneBits::Black) : static_cast<Stone>(place.mStoneType);
     mBoard[place.mIndex] = Square(stone, 1, stoneIsBlack ? 1 : 0);
+    updateSquareTerms(place.mIndex, 1);
 
     if (isCap(place.mStoneType))
     {
@@ -129,7 +138,9 @@ void Position::move(const Move& move)
 
     const bool movingLaterally = (move.mDirection == Direction::Left || move.mDirection == Direction::Right);
     const int offset = getOffset(move.mDirection);
+    updateSquareTerms(move.mIndex, -1);
     Square hand = Square(source, move.mCount); // Removes mCount flats from source
+    updateSquareTerms(move.mIndex, 1);
 
     uint8_t nextIndex = move.mIndex;
     auto dropStone = [&](uint8_t dropCount) {
@@ -140,7 +151,9 @@ void Position::move(const Move& move)
             assert((nextIndex / mSize) == (move.mIndex / mSize)); // Stops us going off the right or left of the board
 
         Square& nextSquare = mBoard[nextIndex];
+        updateSquareTerms(nextIndex, -1);
         nextSquare.add(hand, dropCount);
+        updateSquareTerms(nextIndex, 1);
     };
     move.forEachStone(dropStone);
 
@@ -148,11 +161,15 @@ void Position::move(const Move& move)
 }
 
 void Position::play(const PtnTurn& ptn)
+{
+    play(ptnToMove(ptn));
+}
+
+Move Position::ptnToMove(const PtnTurn& ptn) const
 {
     std::size_t index = axisToIndex(ptn.mCol, ptn.mRank, mSize);
-    auto chosenMove = (ptn.mType == MoveType::Place) ? Move(index, ptn.mPlacedStoneType)
-                                                     : Move(index, ptn.mCount, ptn.mDropCounts, ptn.mDirection);
-    play(chosenMove);
+    return (ptn.mType == MoveType::Place) ? Move(index, ptn.mPlacedStoneType)
+                                          : Move(index, ptn.mCount, ptn.mDropCounts, ptn.mDirection);
 }
 
 void Position::play(const Move& chosenMove)
@@ -163,6 +180,17 @@ void Position::play(const Move& chosenMove)
         move(chosenMove);
 }
 
+void Position::updateSquareTerms(std::size_t index, int sign)
+{
+    const BoardMasks& masks = gBoardMasks[mSize];
+    mTerms.update(index, mBoard[index], sign, masks.mBottom | masks.mTop | masks.mLeft | masks.mRight, mSize);
+}
+
+SquareTerms Position::countSquareTerms() const
+{
+    return sumSquareTerms(mBoard, mSize);
+}
+
 int Position::getOffset(Direction direction) const
 {
     switch (direction)
@@ -214,6 +242,119 @@ MoveBuffer Position::generateMoves() const
     return moves;
 }
 
+// Picks a move the way chooseRandomElement(generateMoves()) would, but only counts the moves rather than making them
+// Placements and each of our stacks' directions are weighted by how many moves they have, then we pick within one
+Move Position::sampleMove(uint64_t random) const
+{
+    auto pick = [&](std::size_t count) { return static_cast<uint32_t>(((random >> 32) * count) >> 32); };
+
+    const Bitboard empty = getEmptyBitboard();
+    auto nthEmptySquare = [&](uint32_t n)
+    {
+        Bitboard remaining = empty;
+        for (; n != 0; --n)
+            remaining &= remaining - 1;
+        return static_cast<std::size_t>(std::countr_zero(remaining));
+    };
+
+    if (mSwaps)
+        return Move(nthEmptySquare(pick(std::popcount(empty))), StoneType::Flat);
+
+    // In the same order addPlaceMoves makes them
+    std::array<StoneType, 3> placeTypes{};
+    std::size_t placeTypeCount = 0;
+    if (mCapReserves[mToPlay])
+        placeTypes[placeTypeCount++] = StoneType::Cap;
+    if (mFlatReserves[mToPlay])
+    {
+        placeTypes[placeTypeCount++] = StoneType::Flat;
+        placeTypes[placeTypeCount++] = StoneType::Wall;
+    }
+
+    struct Spreads
+    {
+        uint8_t mIndex;
+        Direction mDirection;
+        uint8_t mSpreadCountIndex; // Into mSpreadCountMap, with the largest hand, its distance and whether it smashes
+        uint16_t mCount;
+    };
+    std::array<Spreads, 64 * 4> spreads;
+    std::size_t spreadsCount = 0;
+
+    // Walls and caps are all that stop a spread short of the edge, so we look along each direction for the nearest
+    const std::size_t size = mSize;
+    const RayTable& rays = gRayTables[size];
+    const Bitboard walls = mTerms.mStanding & ~(mTerms.mRoads[Player::White] | mTerms.mRoads[Player::Black]);
+    const std::size_t placements = std::popcount(empty) * placeTypeCount;
+    std::size_t total = placements;
+    const bool playerIsBlack = (mToPlay == Player::Black);
+    for (Bitboard stacks = mTerms.mRoads[mToPlay] | walls; stacks != 0; stacks &= stacks - 1)
+    {
+        const std::size_t index = std::countr_zero(stacks);
+        const Square& square = mBoard[index];
+        if (static_cast<bool>(square.mTopStone & StoneBits::Black) != playerIsBlack)
+            continue; // One of their walls
+
+        const std::size_t maxHandSize = std::min<std::size_t>(square.mCount, size);
+        const bool isCapStack = isCap(square.mTopStone);
+        const auto& rayMasks = rays.mMasks[index];
+        const auto& rayLengths = rays.mLengths[index];
+        for (std::size_t directionIndex = 0; directionIndex < 4; ++directionIndex)
+        {
+            std::size_t maxDistance = std::min<std::size_t>(rayLengths[directionIndex], maxHandSize);
+            bool endsInSmash = false;
+            if (const Bitboard standing = rayMasks[directionIndex] & mTerms.mStanding)
+            {
+                // Up and right rays run towards higher indices, down and left towards lower
+                const bool increasing = directionIndex == 0 || directionIndex == 3;
+                const std::size_t nearest = increasing ? std::countr_zero(standing) : 63 - std::countl_zero(standing);
+                const std::size_t standingDistance =
+                    rayLengths[directionIndex] - rays.mLengths[nearest][directionIndex];
+                if (standingDistance <= maxDistance)
+                {
+                    endsInSmash = isCapStack && (walls & (Bitboard{1} << nearest));
+                    maxDistance = endsInSmash ? standingDistance : standingDistance - 1;
+                }
+            }
+            if (maxDistance == 0)
+                continue;
+
+            const auto spreadCountIndex = (maxHandSize - 1) * 16 + (maxDistance - 1) * 2 + endsInSmash;
+            const uint16_t count = mSpreadCountMap[spreadCountIndex];
+            spreads[spreadsCount++] = {static_cast<uint8_t>(index), Directions[directionIndex],
+                                       static_cast<uint8_t>(spreadCountIndex), count};
+            total += count;
+        }
+    }
+
+    std::size_t chosen = pick(total);
+    if (chosen < placements)
+        return Move(nthEmptySquare(chosen / placeTypeCount), placeTypes[chosen % placeTypeCount]);
+
+    chosen -= placements;
+    for (std::size_t spread = 0; spread < spreadsCount; ++spread)
+    {
+        const Spreads& stackSpreads = spreads[spread];
+        if (chosen >= stackSpreads.mCount)
+        {
+            chosen -= stackSpreads.mCount;
+            continue;
+        }
+
+        // Hand sizes step through mDropCountMap 16 entries at a time, from 1 up to the largest
+        for (std::size_t dropCountIndex = stackSpreads.mSpreadCountIndex % 16;; dropCountIndex += 16)
+        {
+            const auto& dropCounts = mDropCountMap[dropCountIndex];
+            if (chosen < dropCounts.size())
+                return Move(stackSpreads.mIndex, dropCountIndex / 16 + 1, dropCounts[chosen], stackSpreads.mDirection);
+            chosen -= dropCounts.size();
+        }
+    }
+
+    assert(false);
+    return Move();
+}
+
 void Position::addPlaceMoves(std::size_t index, MoveBuffer& moves) const
 {
     if (mCapReserves[mToPlay])
@@ -328,78 +469,275 @@ std::vector<uint32_t> Position::generateDropCounts(std::size_t handSize, std::si
     return dropCountVec;
 }
 
-// TODO: This shouldn't be a copy past of the checkRoadWin below
+// The "length" of an island is the larger of its height and width, see evaluate in Engine.cpp
 PlayerPair<std::size_t> Position::countIslands() const
 {
+    const Bitboard firstRank = gBoardMasks[mSize].mBottom;
     PlayerPair<std::size_t> islandCounts{0};
-    uint64_t squareInIsland = 0; // We use this as if it were a map, but with much faster lookup
-    for (std::size_t index = 0; index < mSize * mSize; index++)
+    for (const auto player : {Player::White, Player::Black})
     {
-        if (squareInIsland & (1LL << index))
-            continue;
+        Bitboard remaining = mTerms.mRoads[player];
+        while (remaining != 0)
+        {
+            Bitboard island = floodFill(remaining & -remaining, remaining, mSize);
+            remaining &= ~island;
 
-        Stone topStone = mBoard[index].mTopStone;
-        if (topStone == Stone::Blank || isWall(topStone))
-            continue;
+            uint32_t ranks = 0;
+            Bitboard files = 0;
+            for (std::size_t rank = 0; rank < mSize; ++rank)
+            {
+                Bitboard rankSquares = (island >> (rank * mSize)) & firstRank;
+                ranks |= static_cast<uint32_t>(rankSquares != 0) << rank;
+                files |= rankSquares;
+            }
 
-        uint8_t colour = topStone & StoneBits::Black;
+            auto span = [](uint64_t bits) { return std::bit_width(bits) - 1 - std::countr_zero(bits); };
+            islandCounts[player] += std::max(span(ranks), span(files));
+        }
+    }
 
-        // We do a breadth first search
-        uint64_t parents = 0;
-        parents |= (1LL << index);
+    return islandCounts;
+}
 
-        uint64_t island = 0;
-        int northRank = 0;
-        int eastCol = 0;
-        int southRank = mSize - 1;
-        int westCol = mSize - 1;
+// Roughly how many placements each player is from a road: their flats and caps are free, empty squares and the other
+// player's flats (which a spread could cover) cost one, and walls and the other player's caps block the way
+// Walls block their owner too, as a road through one needs it flattening or moving first
+PlayerPair<std::size_t> Position::countRoadDistances() const
+{
+    const std::size_t size = mSize;
+    const BoardMasks& masks = gBoardMasks[size];
+    PlayerPair<std::size_t> distances{0};
+    for (const auto player : {Player::White, Player::Black})
+    {
+        const Player opponent = player == Player::White ? Player::Black : Player::White;
+        const Bitboard free = mTerms.mRoads[player];
+        const Bitboard steps = getEmptyBitboard() | (mTerms.mRoads[opponent] & ~mTerms.mStanding);
+
+        // The second direction only needs looking at as far as the first got
+        const std::size_t ranks = waveDistance(masks.mBottom, masks.mTop, free, steps, size, size);
+        distances[player] = waveDistance(masks.mLeft, masks.mRight, free, steps, std::min(ranks, size), size);
+        distances[player] = std::min(distances[player], ranks);
+    }
 
-        while (parents != 0)
+    return distances;
+}
+
+Bitboard Position::getRoadBitboard(Player player) const
+{
+    return mTerms.mRoads[player];
+}
+
+Bitboard Position::getEmptyBitboard() const
+{
+    return gBoardMasks[mSize].mBoard & ~mTerms.mOccupied;
+}
+
+// Every empty square where player could place a flat or cap to complete a road
+// A square completes a road if it touches (or is on) one edge, and touches (or is on) the opposite edge,
+// where touching an edge means being next to a group of the player's road stones which reaches that edge
+Bitboard Position::findRoadPlacements(Player player) const
+{
+    if (mSwaps)
+        return 0;
+
+    return findRoadPlacements(player, findEdgeReach(getRoadBitboard(player), mSize));
+}
+
+Bitboard Position::findRoadPlacements(Player player, const EdgeReach& reach) const
+{
+    if (mFlatReserves[player] == 0 && mCapReserves[player] == 0)
+        return 0;
+
+    return reach.joining() & getEmptyBitboard();
+}
+
+// The squares a move puts stones on, so the placed square or every square a spread drops on
+Bitboard Position::getDropSquares(const Move& move) const
+{
+    if (move.mDirection == Direction::None)
+        return Bitboard{1} << move.mIndex;
+
+    Bitboard dropSquares = 0;
+    const int offset = getOffset(move.mDirection);
+    int nextIndex = move.mIndex;
+    move.forEachStone([&](uint8_t) {
+        nextIndex += offset;
+        dropSquares |= (Bitboard{1} << nextIndex);
+    });
+
+    return dropSquares;
+}
+
+// Every move player could make which completes a road for player, as if it were player's turn
+// We never play the moves, we just work out which squares player's road stones would be on afterwards
+MoveBuffer Position::findWinningMoves(Player player) const
+{
+    MoveBuffer moves;
+    if (mSwaps)
+        return moves;
+
+    const Bitboard roadSquares = getRoadBitboard(player);
+    const EdgeReach reach = findEdgeReach(roadSquares, mSize);
+
+    Bitboard roadPlacements = findRoadPlacements(player, reach);
+    while (roadPlacements != 0)
+    {
+        auto index = std::countr_zero(roadPlacements);
+        roadPlacements -= (Bitboard{1} << index);
+
+        if (mCapReserves[player])
+            moves.emplace_back(index, StoneType::Cap);
+        if (mFlatReserves[player])
+            moves.emplace_back(index, StoneType::Flat);
+    }
+
+    addRoadSpreads(player, roadSquares, reach, moves, false);
+    return moves;
+}
+
+bool Position::hasRoadInOne(Player player) const
+{
+    if (mSwaps)
+        return false;
+
+    const Bitboard roadSquares = getRoadBitboard(player);
+    const EdgeReach reach = findEdgeReach(roadSquares, mSize);
+    if (findRoadPlacements(player, reach) != 0)
+        return true;
+
+    MoveBuffer moves;
+    return addRoadSpreads(player, roadSquares, reach, moves, true);
+}
+
+// Every move which might stop our opponent making any of threats, every other move loses straight away
+MoveBuffer Position::generateBlocks(const MoveBuffer& threats) const
+{
+    // To block we have to put a stone somewhere a threat needs, or spread onto one of the opponent's road stones
+    Bitboard threatenedSquares = 0;
+    for (const auto& threat : threats)
+        threatenedSquares |= getDropSquares(threat) | (Bitboard{1} << threat.mIndex);
+
+    Bitboard blockingSquares = threatenedSquares | getRoadBitboard(opponent(mToPlay));
+
+    MoveBuffer moves = generateMoves();
+    std::erase_if(moves, [&](const Move& move) {
+        Bitboard dropSquares = getDropSquares(move);
+        return !(dropSquares & (move.mDirection == Direction::None ? threatenedSquares : blockingSquares));
+    });
+
+    return moves;
+}
+
+// A spread leaves a flat of the colour of the top stone dropped on every square but the last,
+// which gets the original top stone, and the source is left with whatever was underneath the hand
+// The dragon clause means we win if we make a road, even if we make one for our opponent too
+bool Position::addRoadSpreads(Player player, Bitboard roadSquares, const EdgeReach& reach, MoveBuffer& moves,
+                              bool stopAtFirst) const
+{
+    const uint8_t colour = player == Player::Black ? static_cast<uint8_t>(StoneBits::Black) : 0;
+    const uint32_t colourBit = player == Player::Black ? 1 : 0;
+
+    bool foundRoad = false;
+    for (std::size_t index = 0; index < mSize * mSize; ++index)
+    {
+        const Square& square = mBoard[index];
+        if (square.mTopStone == Stone::Blank || (square.mTopStone & StoneBits::Black) != colour)
+            continue;
+
+        const auto maxHandSize = std::min(square.mCount, mSize);
+        const bool isCapStack = isCap(square.mTopStone);
+        const bool topIsRoad = square.mTopStone & StoneBits::Road;
+
+        for (const auto direction : Directions)
         {
-            uint64_t children = 0;
-            while (parents != 0)
+            uint8_t maxDistance = calcMaxDistance(index, maxHandSize, isCapStack, direction);
+            if (maxDistance == 0)
+                continue;
+
+            // The source is lineSquares[0], and a spread can only change which of lineSquares are ours
+            const int offset = getOffset(direction);
+            std::array<Bitboard, 9> lineSquares{};
+            uint32_t originalLine = 0;
+            Bitboard line = 0;
+            for (int distance = 0; distance <= maxDistance; ++distance)
             {
-                auto parentIndex = std::countr_zero(parents);
-                parents -= (1LL << parentIndex);
-                island |= (1LL << parentIndex);
-                squareInIsland |= (1LL << parentIndex);
-
-                int rank = parentIndex % mSize;
-                int col = parentIndex / mSize;
-                northRank = std::max(rank, northRank);
-                eastCol = std::max(col, eastCol);
-                southRank = std::min(southRank, rank);
-                westCol = std::min(col, westCol);
-
-                for (const auto neighbour : mNeighbourMap[parentIndex])
+                lineSquares[distance] = Bitboard{1} << (index + distance * offset);
+                line |= lineSquares[distance];
+                if (roadSquares & lineSquares[distance])
+                    originalLine |= (1 << distance);
+            }
+
+            // Many spreads leave the same squares of the line as ours, so we remember which of those make roads
+            const Bitboard offLine = roadSquares & ~line;
+            std::array<uint8_t, 512> lineMakesRoad{}; // 0 unknown, 1 no road, 2 road
+
+            // If every square we could reach becoming ours couldn't join two edges, don't look at any spreads
+            // Smaller hands reach fewer squares, but once a hand could make a road so could every bigger hand
+            if (!reach.couldJoin(line))
+                continue;
+            bool handCouldMakeRoad = false;
+
+            bool endsInSmash = isCapStack && isWall(mBoard[index + maxDistance * offset].mTopStone);
+            for (std::size_t handSize = 1; handSize <= maxHandSize; ++handSize)
+            {
+                if (!handCouldMakeRoad && handSize < maxDistance)
                 {
-                    if (squareInIsland & (1LL << neighbour))
-                        continue; // Already assigned to an island
+                    Bitboard reachable = 0;
+                    for (std::size_t distance = 0; distance <= handSize; ++distance)
+                        reachable |= lineSquares[distance];
+                    if (!reach.couldJoin(reachable))
+                        continue;
+                }
+                handCouldMakeRoad = true;
 
-                    Stone neighbourStone = mBoard[neighbour].mTopStone;
+                const uint8_t remaining = square.mCount - handSize;
+                const uint32_t hand = square.mStack >> remaining; // The bottom of the hand is bit 0
 
-                    if (neighbourStone == Stone::Blank)
-                        continue; // Empty
-                    if ((neighbourStone & StoneBits::Black) != colour)
-                        continue; // Wrong colour
-                    if (isWall(neighbourStone))
-                        continue; // Wall
+                uint32_t afterSource = originalLine & ~1u;
+                if (remaining && ((square.mStack >> (remaining - 1)) & 1) == colourBit)
+                    afterSource |= 1;
 
-                    children |= (1LL << neighbour);
+                const auto dropCountIndex = (handSize - 1) * 16 + (maxDistance - 1) * 2 + endsInSmash;
+                for (const auto dropCounts : mDropCountMap[dropCountIndex])
+                {
+                    uint32_t afterSpread = afterSource;
+                    uint8_t distance = 0;
+                    uint8_t dropped = 0;
+                    Move spread(index, handSize, dropCounts, direction);
+                    spread.forEachStone([&](uint8_t dropCount) {
+                        ++distance;
+                        dropped += dropCount;
+
+                        bool isRoad = (dropped == handSize) ? topIsRoad : ((hand >> (dropped - 1)) & 1) == colourBit;
+                        if (isRoad)
+                            afterSpread |= (1 << distance);
+                        else
+                            afterSpread &= ~(1u << distance);
+                    });
+
+                    if (lineMakesRoad[afterSpread] == 0)
+                    {
+                        Bitboard afterSquares = offLine;
+                        for (std::size_t bit = 0; bit <= maxDistance; ++bit)
+                            if (afterSpread & (1 << bit))
+                                afterSquares |= lineSquares[bit];
+                        lineMakesRoad[afterSpread] = containsRoad(afterSquares, mSize) ? 2 : 1;
+                    }
+
+                    if (lineMakesRoad[afterSpread] == 2)
+                    {
+                        foundRoad = true;
+                        if (stopAtFirst)
+                            return true;
+                        moves.push_back(spread);
+                    }
                 }
             }
-            parents = children;
         }
-
-        // We find the "length" of the island by taking max(height, width) of the island
-        int islandLength = std::max(northRank - southRank, eastCol - westCol);
-
-        Player islandOwner = colour & StoneBits::Black ? Player::Black : Player::White;
-        islandCounts[islandOwner] += islandLength;
     }
 
-    return islandCounts;
-};
+    return foundRoad;
+}
 
 Result Position::checkRoadWin() const
 {
@@ -587,10 +925,28 @@ Position Position::shift(Shift shiftType) const
         std::size_t shiftedIndex = applyShift(index, mSize, shiftType);
         shiftedPosition.mBoard[shiftedIndex] = mBoard[index];
     }
+    shiftedPosition.mTerms = shiftedPosition.countSquareTerms();
 
     return shiftedPosition;
 }
 
+// Spreads turn with the board, so we see where the next square along ends up to find their new direction
+Move Position::shiftMove(Move move, Shift shiftType) const
+{
+    const auto index = applyShift(move.mIndex, mSize, shiftType);
+    if (move.mDirection != Direction::None)
+    {
+        const auto next = applyShift(move.mIndex + getOffset(move.mDirection), mSize, shiftType);
+        const auto step = static_cast<int>(next) - static_cast<int>(index);
+        move.mDirection = step == static_cast<int>(mSize)    ? Direction::Up
+                          : step == -static_cast<int>(mSize) ? Direction::Down
+                          : step == 1                        ? Direction::Right
+                                                             : Direction::Left;
+    }
+    move.mIndex = index;
+    return move;
+}
+
 Shift Position::getCanonicalShift() const
 {
     std::size_t canonicalPriority = 0;
@@ -619,6 +975,7 @@ void Position::setSquare(std::size_t col, std::size_t rank, const std::string& t
     std::size_t index = axisToIndex(col, rank, mSize);
     assert(index < mSize * mSize);
     Square& square = mBoard[index];
+    updateSquareTerms(index, -1);
 
     PlayerPair<std::size_t> flats{0};
     for (const char c : tpsSquare)
@@ -657,6 +1014,8 @@ void Position::setSquare(std::size_t col, std::size_t rank, const std::string& t
         }
     }
 
+    updateSquareTerms(index, 1);
+
     assert(mFlatReserves.White >= flats.White);
     assert(mFlatReserves.Black >= flats.Black);
     mFlatReserves.White -= flats.White;
@@ -674,4 +1033,4 @@ bool Position::operator!=(const Position& other) const
 }
 
 #include "other/SizeChecker.h"
-static SizeChecker<Position, 520> sizeChecker; // A bit big...
+static SizeChecker<Position, 576> sizeChecker; // A bit big...
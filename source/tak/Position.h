@@ -1,11 +1,13 @@
 #pragma once
 
+#include "Bitboard.h"
 #include "HashCombine.h"
 #include "Move.h"
 #include "Player.h"
 #include "Result.h"
 #include "Shift.h"
 #include "Square.h"
+#include "SquareTerms.h"
 #include "ptn/Ptn.h"
 
 #include <functional>
@@ -35,14 +37,17 @@ class Position
     uint8_t mSwaps;
     int8_t mKomi; // In half points
     Player mToPlay;
+    SquareTerms mTerms;
 
     // Optimisations
     inline static std::vector<std::vector<std::uint32_t>> mDropCountMap{};
+    inline static std::array<std::uint16_t, 128> mSpreadCountMap{}; // Drop counts for every hand size up to the index's
     inline static std::vector<std::vector<std::size_t>> mNeighbourMap{};
     inline static std::size_t mNeighbourMapSize{0};
 
     void place(const Move& place);
     void move(const Move& move);
+    void updateSquareTerms(std::size_t index, int sign); // Call with -1 before changing a square, and 1 after
 
 public:
     explicit Position(std::size_t size, double komi = 0);
@@ -66,12 +71,23 @@ public:
 
     void play(const PtnTurn& ptn);
     void play(const Move& move);
+    Move ptnToMove(const PtnTurn& ptn) const;
     MoveBuffer generateMoves() const;
+    Move sampleMove(uint64_t random) const; // Uniformly random among generateMoves, without generating them all
 
     std::string print() const;
 
     Result checkResult() const;
     PlayerPair<std::size_t> countIslands() const;
+    PlayerPair<std::size_t> countRoadDistances() const;
+
+    Bitboard getRoadBitboard(Player player) const;
+    Bitboard getEmptyBitboard() const;
+    Bitboard findRoadPlacements(Player player) const;
+    Bitboard getDropSquares(const Move& move) const;
+    MoveBuffer findWinningMoves(Player player) const;
+    bool hasRoadInOne(Player player) const;
+    MoveBuffer generateBlocks(const MoveBuffer& threats) const;
 
     void setSquare(std::size_t col, std::size_t rank, const std::string& tpsSquare);
     void togglePlayer()
@@ -96,11 +112,21 @@ public:
     }
     PlayerPair<std::size_t> checkFlatCount() const;
     Position shift(Shift shiftType) const;
+    Move shiftMove(Move move, Shift shiftType) const; // This position's move as played in shift(shiftType)
     Shift getCanonicalShift() const;
     PlayerPair<uint8_t> getReserveCount() const
     {
         return mFlatReserves;
     }
+    PlayerPair<uint8_t> getCapReserveCount() const
+    {
+        return mCapReserves;
+    }
+    const SquareTerms& getSquareTerms() const
+    {
+        return mTerms;
+    }
+    SquareTerms countSquareTerms() const; // From scratch, rather than kept up to date
 
     bool operator==(const Position& other) const;
     bool operator!=(const Position& other) const;
@@ -109,6 +135,9 @@ private:
     void generateOpeningMoves(MoveBuffer& moves) const;
     void addPlaceMoves(std::size_t index, MoveBuffer& moves) const;
     void addMoveMoves(std::size_t index, MoveBuffer& moves) const;
+    Bitboard findRoadPlacements(Player player, const EdgeReach& reach) const;
+    bool addRoadSpreads(Player player, Bitboard roadSquares, const EdgeReach& reach, MoveBuffer& moves,
+                        bool stopAtFirst) const;
 
     static std::vector<uint32_t> generateDropCounts(std::size_t handSize, std::size_t maxDistance, bool endsInSmash);
     std::vector<std::size_t> getNeighbours(std::size_t index) const;
@@ -138,14 +167,7 @@ template <> struct hash<Position>
     {
         std::size_t sizeHash = std::hash<std::size_t>{}(pos.size());
         std::size_t playerHash = std::hash<Player>{}(pos.getPlayer());
-
-        std::size_t squareCount = pos.size() * pos.size();
-        std::size_t boardHash = squareCount;
-        for (std::size_t index = 0; index < squareCount; ++index)
-        {
-            auto square = pos[index];
-            boardHash = hash_combine(boardHash, square);
-        }
+        std::size_t boardHash = pos.getSquareTerms().mBoardHash;
 
         return hash_combine(sizeHash, playerHash, boardHash);
     }
@@ -36,7 +36,7 @@ std::size_t applyShift(std::size_t oldIndex, std::size_t size, Shift shiftType)
     case Shift::RotateCounterClockwise:
         return recompose(flip(colIndex), rowIndex);
     case Shift::RotateTwice:
-        return recompose(flip(colIndex), flip(rowIndex));
+        return recompose(flip(rowIndex), flip(colIndex));
     }
 
     assert(false);
@@ -0,0 +1,13 @@
+#include "SquareTerms.h"
+
+SquareTerms sumSquareTerms(const std::array<Square, 64>& board, std::size_t size)
+{
+    const BoardMasks& masks = gBoardMasks[size];
+    const Bitboard edges = masks.mBottom | masks.mTop | masks.mLeft | masks.mRight;
+
+    SquareTerms terms;
+    for (std::size_t index = 0; index < size * size; ++index)
+        terms.update(index, board[index], 1, edges, size);
+
+    return terms;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "Bitboard.h"
+#include "Player.h"
+#include "Square.h"
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+// A splitmix64 finaliser over everything that makes a square different, so similar squares hash nothing alike
+inline uint64_t hashSquare(std::size_t index, const Square& square)
+{
+    const uint64_t stone = static_cast<uint8_t>(square.mTopStone);
+    uint64_t key = square.mStack | uint64_t{square.mCount} << 32 | stone << 40 | uint64_t{index} << 48;
+    key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9;
+    key = (key ^ (key >> 27)) * 0x94d049bb133111eb;
+    return key ^ (key >> 31);
+}
+
+// Everything the evaluation needs from single squares, summed over the board and kept up to date as squares change
+// Counts are white's minus black's, so an evaluation only has to weight them
+struct SquareTerms
+{
+    Bitboard mOccupied{0};
+    PlayerPair<Bitboard> mRoads{0}; // Flats and caps, the squares countIslands and road checks care about
+    Bitboard mStanding{0};          // Walls and caps, which block roads
+    int16_t mFlats{0};
+    int16_t mCaps{0};
+    int16_t mStackControl{0}; // Stones in stacks each player's top stone controls
+    int16_t mNobleControl{0}; // The same, for stacks topped by walls or caps
+    int16_t mEdgeStones{0};
+    int16_t mReserves{0};     // Stones under the top stone and its own colour, that it could carry off with it
+    int16_t mCaptives{0};     // The same, of the other colour, which are freed if the stack spreads
+    int16_t mHardCaptives{0}; // Stones of the other colour buried deeper than a carry can reach
+    uint64_t mBoardHash{0}; // Each square hashed with its index and XORed in, so it's as cheap to keep up as the rest
+
+    // The stack's composition under its top stone, from popcounts of masks over mStack, size being the carry limit
+    void updateStack(const Square& square, int colourSign, std::size_t size)
+    {
+        const uint32_t below = square.mCount - 1u;
+        const uint32_t deep = below >= size ? below - size + 1 : 0; // Stones too far down to carry
+        const uint32_t deepMask = (uint32_t{1} << deep) - 1;
+        const uint32_t carryMask = ((uint32_t{1} << below) - 1) & ~deepMask;
+        const uint32_t others = square.mTopStone & StoneBits::Black ? ~square.mStack : square.mStack;
+
+        const int carriedOthers = std::popcount(others & carryMask);
+        mReserves += static_cast<int>(below - deep - carriedOthers) * colourSign;
+        mCaptives += carriedOthers * colourSign;
+        mHardCaptives += std::popcount(others & deepMask) * colourSign;
+    }
+
+    // Call with -1 before changing a square, and 1 after
+    void update(std::size_t index, const Square& square, int sign, Bitboard edges, std::size_t size)
+    {
+        if (square.mTopStone == Stone::Blank)
+            return;
+
+        const Bitboard bit = Bitboard{1} << index;
+        const bool isBlack = square.mTopStone & StoneBits::Black;
+        const int colourSign = isBlack ? -sign : sign;
+
+        // Removing a square flips its bits back, so the bitboards and hash don't need the sign
+        mOccupied ^= bit;
+        mBoardHash ^= hashSquare(index, square);
+        if (square.mTopStone & StoneBits::Road)
+            mRoads[isBlack ? Player::Black : Player::White] ^= bit;
+        if (square.mTopStone & StoneBits::Standing)
+            mStanding ^= bit;
+
+        if (isFlat(square.mTopStone))
+            mFlats += colourSign;
+        else if (isCap(square.mTopStone))
+            mCaps += colourSign;
+
+        mStackControl += square.mCount * colourSign;
+        if (square.mTopStone & StoneBits::Standing)
+            mNobleControl += square.mCount * colourSign;
+
+        if (bit & edges)
+            mEdgeStones += colourSign;
+
+        if (square.mCount > 1)
+            updateStack(square, colourSign, size);
+    }
+
+    bool operator==(const SquareTerms& other) const = default;
+};
+
+// From scratch, rather than kept up to date, for when a whole board changes at once
+SquareTerms sumSquareTerms(const std::array<Square, 64>& board, std::size_t size);
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "Game.h"
+#include "Tps.h"
+#include "engine/TinueSolver.h"
+#include "other/ArgParse.h"
+#include "other/StringOps.h"
+#include "other/Time.h"
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+
+// Sets up a position from -tps and/or -moves, and tries to prove a tinue for the player to move
+void analyse(const OptionMap& options)
+{
+    std::size_t gameSize = options.contains("size") ? std::stoi(options.at("size")) : 6;
+    double komi = options.contains("komi") ? std::stod(options.at("komi")) : 0;
+    std::size_t nodeBudget = options.contains("nodes") ? std::stoul(options.at("nodes")) : 1'000'000;
+
+    Game game = options.contains("tps") ? gameFromTps(options.at("tps"), komi) : Game(gameSize, komi);
+    if (options.contains("moves"))
+    {
+        for (const auto& move : split(options.at("moves"), ' '))
+            game.play(move);
+    }
+    std::cout << game.print() << std::endl;
+
+    TinueSolver solver(1 << 20, nodeBudget); // We've got more time than in a game, so use a bigger table
+    auto before = timeInMics();
+    auto tinue = solver.solve(game.getPosition());
+    auto duration = timeInMics() - before;
+
+    std::size_t size = game.getPosition().size();
+    switch (tinue.mStatus)
+    {
+    case TinueStatus::Tinue:
+        std::cout << "Tinue starting with " << moveToPtn(tinue.mMove, size);
+        break;
+    case TinueStatus::NoTinue:
+        std::cout << "No tinue";
+        break;
+    case TinueStatus::Unknown:
+        std::cout << "Couldn't prove or disprove tinue";
+        break;
+    }
+    std::cout << " after " << tinue.mNodes << " nodes and " << duration << " mics" << std::endl;
+}
@@ -0,0 +1,110 @@
+#include <atomic>
+#include <iostream>
+#include <thread>
+
+#include "Game.h"
+#include "engine/OpeningBook.h"
+#include "other/ArgParse.h"
+#include "other/StringOps.h"
+#include "other/Time.h"
+
+// Tallies the game's first maxPlies moves, scored by how the game went for whoever played them
+static void addGame(const Game& game, std::size_t maxPlies, OpeningBookBuilder& builder)
+{
+    // Games which were resigned or lost on time only have their result in the PTN
+    Result result = game.getPtnResult() != Result::None ? game.getPtnResult() : game.checkResult();
+    if (result == Result::None)
+        return;
+
+    const float whiteScore = result == Result::Draw ? 0.5f : (result & StoneBits::Black) ? 0.0f : 1.0f;
+    Position position(game.getPosition().size(), game.getPosition().getKomi());
+    const auto& moves = game.getMoveList();
+    for (std::size_t ply = 0; ply < std::min(maxPlies, moves.size()); ++ply)
+    {
+        if (position.checkResult() != Result::None)
+            break;
+
+        const Move move = position.ptnToMove(moves[ply]);
+        builder.add(position, move, position.getPlayer() == Player::White ? whiteScore : 1.0f - whiteScore);
+        position.play(move);
+    }
+}
+
+// Compiles an opening book from the first -plies moves of the games in -games, for one -size and -komi
+// Every move gets how often it was played from its canonical position and how those games went for whoever played it
+// -minGames drops moves played fewer times than that, which keeps one off games from a big corpus out of the book
+int main(int argc, const char* argv[])
+{
+    auto options = parseArgs(argc, argv);
+    if (!options.contains("games") || !options.contains("size"))
+    {
+        std::cout << "Usage: bookbuilder -games <ptn files> -size n [-komi 0] [-out book.bin] [-plies 12] "
+                     "[-minGames 1] [-threads n]"
+                  << std::endl;
+        return 1;
+    }
+
+    std::size_t size = std::stoul(options.at("size"));
+    if (size < 3 || size > 8)
+    {
+        std::cout << "No such size " << size << std::endl;
+        return 1;
+    }
+
+    double komi = options.contains("komi") ? std::stod(options.at("komi")) : 0;
+    std::string outPath = options.contains("out") ? options.at("out") : "book.bin";
+    std::size_t maxPlies = options.contains("plies") ? std::stoul(options.at("plies")) : 12;
+    uint32_t minGames = options.contains("minGames") ? std::stoul(options.at("minGames")) : 1;
+    std::size_t threadCount =
+        options.contains("threads") ? std::stoul(options.at("threads")) : std::thread::hardware_concurrency();
+    threadCount = std::max<std::size_t>(threadCount, 1);
+
+    // Each thread takes the next file to read and tallies its games in a builder of its own
+    const auto paths = split(options.at("games"), ' ');
+    std::vector<OpeningBookBuilder> builders(std::min(threadCount, paths.size()), OpeningBookBuilder(size, komi));
+    std::atomic<std::size_t> nextPath{0};
+    std::atomic<std::size_t> gameCount{0};
+
+    // Game's PTN constructor prints every game it reads, which we don't need thousands of
+    std::streambuf* coutBuffer = std::cout.rdbuf(nullptr);
+    auto before = timeInMics();
+    std::vector<std::thread> threads;
+    for (auto& builder : builders)
+    {
+        threads.emplace_back(
+            [&]()
+            {
+                for (std::size_t index = nextPath++; index < paths.size(); index = nextPath++)
+                {
+                    for (const auto& game : readGames(paths[index]))
+                    {
+                        if (game.getPosition().size() != size || game.getPosition().getKomi() != komi)
+                            continue;
+
+                        addGame(game, maxPlies, builder);
+                        ++gameCount;
+                    }
+                }
+            });
+    }
+    for (auto& thread : threads)
+        thread.join();
+    std::cout.rdbuf(coutBuffer);
+    std::cout.clear();
+
+    OpeningBookBuilder book(size, komi);
+    for (const auto& builder : builders)
+        book.merge(builder);
+    book.prune(minGames);
+    std::cout << "Read " << gameCount << " " << size << "s games with komi " << komi << " in "
+              << (timeInMics() - before) / 1000 << " ms, the book has " << book.positionCount() << " positions"
+              << std::endl;
+
+    if (!book.write(outPath))
+    {
+        std::cout << "Couldn't write the book to " << outPath << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -2,6 +2,7 @@
 
 #include "Game.h"
 #include "engine/Engine.h"
+#include "engineOptions.h"
 
 #include <cstddef>
 #include <iostream>
@@ -10,7 +11,7 @@
 
 void playCommandLine(const OptionMap& options)
 {
-    Engine engine;
+    Engine engine(parseEngineOptions(options));
 
     std::size_t gameSize = options.contains("size") ? std::stoi(options.at("size")) : 6;
     Game game = Game(gameSize);
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "engine/Engine.h"
+#include "log/Logger.h"
+#include "other/ArgParse.h"
+
+#include <string>
+
+// The engine switches tei, playtak and cli all take:
+// -openingBook <file>, -bookSelection <weighted|best> for how it picks between book moves,
+// -mcts to search with MonteCarlo rather than negamax, -threads <n>,
+// and for MonteCarlo's leaves -leaf <rollout|evaluate|negamax>, -rolloutPlies <n> and -leafDepth <n>
+EngineOptions parseEngineOptions(const OptionMap& options)
+{
+    EngineOptions engineOptions;
+    if (options.contains("openingBook"))
+        engineOptions.mOpeningBookPath = options.at("openingBook");
+
+    if (options.contains("bookSelection"))
+    {
+        const auto& selection = options.at("bookSelection");
+        if (selection == "best")
+            engineOptions.mBookSelection = BookSelection::BestScore;
+        else if (selection != "weighted")
+            Logger("options") << LogLevel::Warn << "Unknown book selection " << selection << ", using weighted"
+                              << Flush;
+    }
+
+    engineOptions.mUseMonteCarlo = options.contains("mcts");
+    if (options.contains("threads"))
+        engineOptions.mThreadCount = std::stoul(options.at("threads"));
+    if (options.contains("rolloutPlies"))
+        engineOptions.mRolloutPlies = std::stoul(options.at("rolloutPlies"));
+    if (options.contains("leafDepth"))
+        engineOptions.mLeafDepth = std::stoi(options.at("leafDepth"));
+
+    if (options.contains("leaf"))
+    {
+        const auto& leaf = options.at("leaf");
+        if (leaf == "evaluate")
+            engineOptions.mLeafEvaluation = LeafEvaluation::Evaluate;
+        else if (leaf == "negamax")
+            engineOptions.mLeafEvaluation = LeafEvaluation::Negamax;
+        else if (leaf != "rollout")
+            Logger("options") << LogLevel::Warn << "Unknown leaf evaluation " << leaf << ", rolling out" << Flush;
+    }
+
+    return engineOptions;
+}
@@ -1,6 +1,9 @@
 #include <iostream>
 
+#include "analyse.h"
 #include "cmdLine.h"
+#include "engine/Engine.h"
+#include "engine/Nnue.h"
 #include "log/Logger.h"
 #include "other/ArgParse.h"
 #include "playtak.h"
@@ -18,12 +21,21 @@ int main(int argc, const char* argv[])
             rootLogger.setLogToStdOut(true);
     }
 
+    if (options.contains("weights"))
+        loadEvaluationWeights(options.at("weights"), gEvaluationWeights); // As written by tune
+
+    // Swaps the handcrafted evaluation for a network, before any engines are made
+    if (options.contains("nnue") && gNnueNetwork.load(options.at("nnue")))
+        gDefaultEvaluator = &nnueEvaluate;
+
     if (options.contains("tei"))
         tei(options);
     else if (options.contains("playtak"))
         playtak(options);
     else if (options.contains("cli"))
         playCommandLine(options);
+    else if (options.contains("analyse"))
+        analyse(options);
     else
         tei(options); // Make this the default just so people can run with TEI without passing any arguments
 
@@ -2,6 +2,7 @@
 
 #include "Game.h"
 #include "engine/Engine.h"
+#include "engineOptions.h"
 #include "other/StringOps.h"
 
 #include <cassert>
@@ -23,7 +24,7 @@ Game parseTeiPosition(std::vector<std::string> words, std::size_t size)
     return game;
 }
 
-void tei(const OptionMap&)
+void tei(const OptionMap& options)
 {
     Logger logger("tei");
     // We probably want to deal with the "tei" string before here
@@ -41,6 +42,7 @@ void tei(const OptionMap&)
 
     std::size_t size = 5;
     Game game(size);
+    Engine engine(parseEngineOptions(options)); // Kept between moves, so MonteCarlo can reuse its tree
 
     while (getline(std::cin, input))
     {
@@ -69,7 +71,6 @@ void tei(const OptionMap&)
             auto millisRemaining = colour == Player::White ? std::stoi(words[2]) : std::stoi(words[4]);
             double thinkingTime = (millisRemaining / 1000.0) / 10.0;
             std::cout << "info score cp 1 time 1 pv a1" << std::endl; // TODO: This is obviously nonsense
-            Engine engine;
             std::cout << "bestmove " << engine.chooseMove(game.getPosition(), thinkingTime) << std::endl;
             continue;
         }
@@ -0,0 +1,81 @@
+#include <iostream>
+
+#include "Game.h"
+#include "engine/Engine.h"
+#include "engine/Tuner.h"
+#include "other/ArgParse.h"
+#include "other/StringOps.h"
+#include "other/Time.h"
+
+// Tunes the handcrafted evaluation's weights on the results of the games in -games, and writes them to -out
+// tak -weights <file> then plays with them, and -weights here starts tuning from an earlier run
+// With -size only games of that size are used, and the weights are written for that size alone
+int main(int argc, const char* argv[])
+{
+    auto options = parseArgs(argc, argv);
+    if (!options.contains("games"))
+    {
+        std::cout << "Usage: tune -games <ptn files> [-size n] [-out weights.txt] [-weights start.txt] "
+                     "[-epochs 1000] [-rate 0.05] [-threads n]"
+                  << std::endl;
+        return 1;
+    }
+
+    std::string outPath = options.contains("out") ? options.at("out") : "weights.txt";
+    std::size_t epochs = options.contains("epochs") ? std::stoul(options.at("epochs")) : 1000;
+    double learningRate = options.contains("rate") ? std::stod(options.at("rate")) : 0.05;
+    std::size_t threadCount =
+        options.contains("threads") ? std::stoul(options.at("threads")) : std::thread::hardware_concurrency();
+
+    std::size_t size = options.contains("size") ? std::stoul(options.at("size")) : 0;
+    if (size != 0 && (size < 3 || size > 8))
+    {
+        std::cout << "No such size " << size << std::endl;
+        return 1;
+    }
+
+    SizeEvaluationWeights startWeights = gEvaluationWeights;
+    if (options.contains("weights") && !loadEvaluationWeights(options.at("weights"), startWeights))
+        return 1;
+    const EvaluationWeights start = startWeights[size != 0 ? size : 6]; // Without a size we tune the 6s weights
+
+    // Game's PTN constructor prints every game it reads, which we don't need thousands of
+    std::streambuf* coutBuffer = std::cout.rdbuf(nullptr);
+    auto before = timeInMics();
+    std::vector<TuningPosition> positions;
+    std::size_t gameCount = 0;
+    for (const auto& path : split(options.at("games"), ' '))
+    {
+        for (const auto& game : readGames(path))
+        {
+            if (size != 0 && game.getPosition().size() != size)
+                continue;
+
+            addTuningPositions(game, positions);
+            ++gameCount;
+        }
+    }
+    std::cout.rdbuf(coutBuffer);
+    std::cout.clear();
+    std::cout << "Read " << positions.size() << " quiet positions from " << gameCount << " games in "
+              << (timeInMics() - before) / 1000 << " ms" << std::endl;
+
+    Tuner tuner(positions, threadCount);
+    tuner.fitScale(start);
+
+    before = timeInMics();
+    auto tuned = Tuner::fromVector(tuner.tune(start, epochs, learningRate));
+    std::cout << "Tuning took " << (timeInMics() - before) / 1000 << " ms, loss went from " << tuner.loss(start)
+              << " to " << tuner.loss(tuned) << " after rounding" << std::endl;
+
+    for (const auto& field : gEvaluationWeightFields)
+        std::cout << field.mName << ": " << start.*field.mWeight << " -> " << tuned.*field.mWeight << std::endl;
+
+    if (!saveEvaluationWeights(outPath, tuned, size))
+    {
+        std::cout << "Couldn't write weights to " << outPath << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
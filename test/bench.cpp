@@ -5,12 +5,32 @@
 
 #include "tak/Position.h"
 #include "tak/Game.h" // Game is basically the interface to Position
+#include "engine/EndgameSolver.h"
+#include "engine/MonteCarlo.h"
+#include "engine/Nnue.h"
+#include "engine/OpeningBook.h"
+#include "engine/TinueSolver.h"
 #include "other/StringOps.h"
 #include "other/Time.h"
+#include "other/Xoshiro.h"
 
 #include "utility.h"
 #include "benchmark.h"
 
+#ifndef LOW_MEMORY_COMPILE
+#include "other/MappedFile.h"
+#include "ptn/Lexer.h"
+#include "ptn/StreamLexer.h"
+
+#include <fstream>
+#endif
+
+#include <algorithm>
+#include <filesystem>
+#include <limits>
+#include <map>
+#include <random>
+
 // Some of these functions will probably take ages if running unoptimised
 
 int main()
@@ -64,6 +84,25 @@ int main()
         auto generateMovesTinueSixes = [&]() { return pos.generateMoves(); };
         runBenchmark(generateMovesTinueSixes);
 
+        Xoshiro256 random(1);
+        auto sampleMoveTinueSixes = [&]() { return pos.sampleMove(random()); };
+        runBenchmark(sampleMoveTinueSixes);
+
+        auto countSquareTermsTinueSixes = [&]() { return pos.countSquareTerms(); };
+        runBenchmark(countSquareTermsTinueSixes);
+
+        auto countIslandsTinueSixes = [&]() { return pos.countIslands(); };
+        runBenchmark(countIslandsTinueSixes);
+
+        auto countRoadDistancesTinueSixes = [&]() { return pos.countRoadDistances(); };
+        runBenchmark(countRoadDistancesTinueSixes);
+
+        auto hasRoadInOneTinueSixes = [&]() { return pos.hasRoadInOne(pos.getPlayer()); };
+        runBenchmark(hasRoadInOneTinueSixes);
+
+        auto findWinningMovesTinueSixes = [&]() { return pos.findWinningMoves(pos.getPlayer()); };
+        runBenchmark(findWinningMovesTinueSixes);
+
         auto randomPlace = Move(1, StoneType::Flat); // a1 is occupado
         auto copyAndPlayTinueSixes = [&]() { Position nextPosition(pos); nextPosition.play(randomPlace); return nextPosition; };
         runBenchmark(copyAndPlayTinueSixes);
@@ -86,6 +125,40 @@ int main()
         // Doesn't make sense to generate moves or play a move when the game is over
     };
 
+    "Nnue Benchmarks"_test = []
+    {
+        NnueNetwork network;
+        network.randomise(1);
+
+        Game game(6);
+        std::string movesTillTinue = "a6 f6 d4 c4 d3 c3 d2 c5 c2 d5 e4 b5 e5 Ce3 f5 e3+ f4 f3 e3 b6 "
+                                     "Cb4 b2 b3 c4> b4+ c4 2b5> c6 3c5- c5 4c4> c4 c1 d5> d6 Sd5 f2";
+        for (const auto& move : split(movesTillTinue, ' '))
+            game.play(move);
+
+        auto pos = game.getPosition();
+
+        auto nnueEvaluateScalarTinueSixes = [&]() { return network.evaluate(pos, NnueKernel::Scalar); };
+        runBenchmark(nnueEvaluateScalarTinueSixes);
+
+        if (bestNnueKernel() == NnueKernel::Avx2)
+        {
+            auto nnueEvaluateAvx2TinueSixes = [&]() { return network.evaluate(pos, NnueKernel::Avx2); };
+            runBenchmark(nnueEvaluateAvx2TinueSixes);
+        }
+
+        // Evaluating two positions a move apart in turn, so the accumulator has to follow a move each time
+        auto nextPos = pos;
+        nextPos.play(Move(1, StoneType::Flat));
+        bool evaluateNext = false;
+        auto nnueEvaluateAlternatingTinueSixes = [&]()
+        {
+            evaluateNext = !evaluateNext;
+            return network.evaluate(evaluateNext ? nextPos : pos);
+        };
+        runBenchmark(nnueEvaluateAlternatingTinueSixes);
+    };
+
     "Perft 6s Opening Bench"_test = []
     {
         Game game(6);
@@ -114,10 +187,33 @@ int main()
         std::cout << "Searching to depth 5 from open of a 6s game took " << duration << " mics" << std::endl;
     };
 
+    "1s 6s Opening Monte Carlo Search Bench"_test = []
+    {
+        // The same time control as the negamax searches get, to compare them under
+        for (auto leafEvaluation : {LeafEvaluation::Rollout, LeafEvaluation::Evaluate})
+        {
+            EngineOptions options;
+            options.mUseMonteCarlo = true;
+            options.mLeafEvaluation = leafEvaluation;
+            Engine engine(options);
+            Game game(6);
+            for (const auto& move : split("a1 f6 c3 d4", ' '))
+                game.play(move);
+
+            auto engineMove = engine.chooseMove(game.getPosition(), 1);
+            const auto& stats = engine.getStats();
+            std::cout << (leafEvaluation == LeafEvaluation::Rollout ? "Rolling out" : "Evaluating") << " leaves chose "
+                      << engineMove << " after " << stats.mPlayouts << " playouts, with " << stats.mTreeNodes
+                      << " nodes in " << stats.mTreeMemory / (1024 * 1024) << " Megs" << std::endl;
+        }
+    };
+
     "Depth 5 6s Tinue Search Bench"_test = []
     {
         Game game(6);
-        Engine engine;
+        EngineOptions options;
+        options.mUseTinueSolver = false; // The tinue solver has its own bench below
+        Engine engine(options);
 
         std::string moves = {
          "a1 b2 c2 b3 d2 e2 c3 Cd3 e3 d1 b4 d4 c4 d5 d6 e2< e2 c6 d6- c5 e5 d6 c2> "
@@ -143,6 +239,319 @@ int main()
         std::cout << "Finding win at depth 5 took " << duration << " mics" << std::endl;
     };
 
+    "6s Tinue Solver Bench"_test = []
+    {
+        Game game(6);
+        TinueSolver solver;
+
+        std::string moves = {
+         "a1 b2 c2 b3 d2 e2 c3 Cd3 e3 d1 b4 d4 c4 d5 d6 e2< e2 c6 d6- c5 e5 d6 c2> "
+         "d3- d3 2d2+ e2< 3d3- e2 d3 c4+ 6d2+114 c2 2d4-11 c3> 6d5-15 d5 d6- e5< d4+ "
+         "2c5> 6d3+15 d4- 6d5- 4d3-22 6d4< Cd3 5d5<221 a2 a1+ a1 2a2> b1 Sc1 b1+ c1+ "
+         "4b2+112 2c5< b4+ a5> b4+ Sc5 5b5+ c5< 5b6>122 3b5-12 d5 2c2> d3-* 4b3>13 e4 "
+         "6c4>15 e1 6e4-"};
+
+        for (const auto& move : split(moves, ' '))
+        {
+            game.play(move);
+        }
+
+        auto before = timeInMics();
+        auto tinue = solver.solve(game.getPosition());
+        auto after = timeInMics();
+        auto duration = after - before;
+
+        expect(tinue.mStatus == TinueStatus::Tinue);
+        std::cout << "Proving tinue took " << duration << " mics and " << tinue.mNodes << " nodes" << std::endl;
+    };
+
+    "5s Monte Carlo Convergence Bench"_test = []
+    {
+        // Black threatens a road on the a file, so any move which doesn't block it loses
+        Game game(5);
+        for (const auto& move : split("a1 e5 b2 a2 c3 a3 d4 a4", ' '))
+            game.play(move);
+        const Position& pos = game.getPosition();
+
+        // How often each selection blocks, and agrees with itself, as we give it more playouts
+        constexpr std::size_t searchCount = 8;
+        const std::pair<MonteCarloSelection, const char*> selections[] = {{MonteCarloSelection::Random, "Random"},
+                                                                          {MonteCarloSelection::Uct, "UCT"},
+                                                                          {MonteCarloSelection::Puct, "PUCT"}};
+        for (const auto& [selection, name] : selections)
+        {
+            MonteCarlo monteCarlo(MonteCarlo::sDefaultMaxNodes, MonteCarloOptions(selection));
+            for (std::size_t playouts : {250, 1000, 4000})
+            {
+                std::size_t blocks = 0;
+                std::map<std::string, std::size_t> chosen;
+                auto before = timeInMics();
+                for (std::size_t search = 0; search < searchCount; ++search)
+                {
+                    auto move = monteCarlo.search(pos, playouts, std::numeric_limits<int64_t>::max());
+                    Position nextPosition(pos);
+                    nextPosition.play(move);
+                    blocks += !nextPosition.hasRoadInOne(Player::Black);
+                    ++chosen[moveToPtn(move, 5)];
+                }
+                auto after = timeInMics();
+                auto duration = (after - before) / searchCount;
+
+                auto mostChosen = std::max_element(chosen.begin(), chosen.end(), [](const auto& lhs, const auto& rhs)
+                                                   { return lhs.second < rhs.second; });
+                std::cout << name << " with " << playouts << " playouts blocked " << blocks << "/" << searchCount
+                          << " times and chose " << mostChosen->first << " " << mostChosen->second << "/"
+                          << searchCount << " times, taking " << duration << " mics a search" << std::endl;
+            }
+        }
+    };
+
+    "5s Random Playout Bench"_test = []
+    {
+        Game game(5);
+        for (const auto& move : split("a1 e5 b2 a2 c3 a3 d4 a4", ' '))
+            game.play(move);
+
+        // Playing out by picking from every generated move, as Monte Carlo rollouts used to, against sampleMove
+        constexpr std::size_t playouts = 2000;
+        std::default_random_engine randomEngine(1);
+        auto generatedPlayout = [&]()
+        {
+            Position pos(game.getPosition());
+            while (pos.checkResult() == Result::None)
+            {
+                auto moves = pos.generateMoves();
+                std::uniform_int_distribution<std::size_t> range(0, moves.size() - 1);
+                pos.play(moves[range(randomEngine)]);
+            }
+            return pos;
+        };
+
+        Xoshiro256 random(1);
+        auto sampledPlayout = [&]()
+        {
+            Position pos(game.getPosition());
+            while (pos.checkResult() == Result::None)
+                pos.play(pos.sampleMove(random()));
+            return pos;
+        };
+
+        benchmark("generatedPlayoutFives", generatedPlayout, playouts);
+        benchmark("sampledPlayoutFives", sampledPlayout, playouts);
+    };
+
+    "5s Monte Carlo Threads Bench"_test = []
+    {
+        Game game(5);
+        for (const auto& move : split("a1 e5 b2 a2 c3 a3 d4 a4", ' '))
+            game.play(move);
+
+        constexpr std::size_t playouts = 4000;
+        for (auto parallelism : {MonteCarloParallelism::Tree, MonteCarloParallelism::Root})
+        {
+            for (std::size_t threads : {1, 2, 4})
+            {
+                MonteCarlo monteCarlo(MonteCarlo::sDefaultMaxNodes,
+                                      MonteCarloOptions(MonteCarloSelection::Puct, 0.7f, threads, parallelism));
+                auto before = timeInMics();
+                monteCarlo.search(game.getPosition(), playouts, std::numeric_limits<int64_t>::max());
+                auto after = timeInMics();
+                auto duration = after - before;
+
+                std::cout << (parallelism == MonteCarloParallelism::Tree ? "Tree" : "Root") << " parallel with "
+                          << threads << " threads played out " << playouts * micsInSecond / duration
+                          << " times a second" << std::endl;
+            }
+        }
+    };
+
+    "5s Monte Carlo Leaf Evaluation Bench"_test = []
+    {
+        // The convergence bench's position, but with a time budget, so cheaper leaves get more playouts
+        Game game(5);
+        for (const auto& move : split("a1 e5 b2 a2 c3 a3 d4 a4", ' '))
+            game.play(move);
+
+        struct LeafMode
+        {
+            const char* mName;
+            LeafEvaluation mLeafEvaluation;
+            std::size_t mRolloutPlies;
+            int mLeafDepth;
+        };
+        const LeafMode modes[] = {{"Rollout", LeafEvaluation::Rollout, 0, 0},
+                                  {"Evaluate", LeafEvaluation::Evaluate, 0, 0},
+                                  {"Evaluate after 8 plies", LeafEvaluation::Evaluate, 8, 0},
+                                  {"Negamax depth 1", LeafEvaluation::Negamax, 0, 1},
+                                  {"Negamax depth 2", LeafEvaluation::Negamax, 0, 2}};
+
+        constexpr int64_t budget = micsInSecond / 4;
+        constexpr int searches = 8;
+        for (const auto& mode : modes)
+        {
+            MonteCarloOptions options(MonteCarloSelection::Puct);
+            options.mLeafEvaluation = mode.mLeafEvaluation;
+            options.mRolloutPlies = mode.mRolloutPlies;
+            options.mLeafDepth = mode.mLeafDepth;
+
+            int blocks = 0;
+            std::size_t playouts = 0;
+            for (int search = 0; search < searches; ++search)
+            {
+                MonteCarlo monteCarlo(MonteCarlo::sDefaultMaxNodes, options);
+                auto move = monteCarlo.search(game.getPosition(), std::numeric_limits<std::size_t>::max(),
+                                              timeInMics() + budget);
+                playouts += monteCarlo.getPlayouts();
+
+                Position position(game.getPosition());
+                position.play(move);
+                blocks += position.hasRoadInOne(Player::Black) ? 0 : 1;
+            }
+
+            std::cout << mode.mName << " blocked " << blocks << "/" << searches << " times with "
+                      << playouts / searches << " playouts in a quarter second" << std::endl;
+        }
+    };
+
+    "Opening Book Bench"_test = []
+    {
+        // Every move of the first four plies of a 5s game, far more than a text book we would want to read at startup
+        OpeningBookBuilder builder(5);
+        std::vector<Position> positions{Position(5)};
+        for (int ply = 0; ply < 4; ++ply)
+        {
+            std::vector<Position> nextPositions;
+            for (const auto& position : positions)
+            {
+                for (const auto& move : position.generateMoves())
+                {
+                    builder.add(position, move);
+                    nextPositions.push_back(position);
+                    nextPositions.back().play(move);
+                }
+            }
+            if (ply < 3)
+                positions = std::move(nextPositions);
+        }
+
+        const std::string path = (std::filesystem::temp_directory_path() / "bench.book").string();
+        builder.write(path);
+        auto before = timeInMics();
+        OpeningBook book(path);
+        auto after = timeInMics();
+        std::cout << "Mapping a book of " << book.positionCount() << " positions took " << after - before << " mics"
+                  << std::endl;
+
+        std::vector<Position> canonicalPositions;
+        for (std::size_t index = 0; index < positions.size(); index += 97)
+            canonicalPositions.push_back(positions[index].shift(positions[index].getCanonicalShift()));
+        std::size_t next = 0;
+        auto bookLookup = [&]() { return book.contains(canonicalPositions[next++ % canonicalPositions.size()]); };
+        runBenchmark(bookLookup);
+
+        // What Engine does each book move, a lookup that copies nothing then a weighted pick
+        Xoshiro256 random(0);
+        auto bookProbe = [&]()
+        {
+            const auto responses = book.getResponses(canonicalPositions[next++ % canonicalPositions.size()]);
+            return responses.empty() ? Move() : OpeningBook::select(responses, BookSelection::Weighted, random).mMove;
+        };
+        runBenchmark(bookProbe);
+        std::filesystem::remove(path);
+    };
+
+    "5s Monte Carlo Tree Reuse Bench"_test = []
+    {
+        // Self play, so each search starts two plies below the last one's root
+        Game game(5);
+        MonteCarlo monteCarlo;
+        constexpr std::size_t playouts = 4000;
+        std::size_t searches = 0;
+        std::size_t carriedOver = 0;
+        auto before = timeInMics();
+        while (game.checkResult() == Result::None && searches < 30)
+        {
+            auto move = monteCarlo.search(game.getPosition(), playouts, std::numeric_limits<int64_t>::max());
+            carriedOver += monteCarlo.getNodes()[0].mPlayCount - monteCarlo.getPlayouts();
+            game.play(moveToPtn(move, 5));
+            ++searches;
+        }
+        auto after = timeInMics();
+
+        std::cout << "Reusing the tree carried over " << carriedOver / searches << " playouts a move on average, "
+                  << searches << " searches took " << (after - before) / searches << " mics each" << std::endl;
+    };
+
+#ifndef LOW_MEMORY_COMPILE
+    "Endgame Solver Bench"_test = []
+    {
+        // Replay games which went to flats, and solve them from a few plies before the end
+        for (const std::string ptnFile : {"games/FlatLoss.ptn", "games/BoardFillDraw.ptn"})
+        {
+            Game fullGame = readGame(ptnFile);
+            const auto& moveList = fullGame.getMoveList();
+            for (std::size_t pliesFromEnd = 1; pliesFromEnd <= 3; ++pliesFromEnd)
+            {
+                Game game(fullGame.getPosition().size(), fullGame.getPosition().getKomi());
+                for (std::size_t ply = 0; ply + pliesFromEnd < moveList.size(); ++ply)
+                    game.play(moveList[ply].mSourceString);
+
+                EndgameSolver solver;
+                auto before = timeInMics();
+                auto endgame = solver.solve(game.getPosition());
+                auto after = timeInMics();
+                auto duration = after - before;
+
+                std::cout << "Solving " << ptnFile << " from " << pliesFromEnd << " plies before the end took "
+                          << duration << " mics and " << endgame.mNodes << " nodes" << std::endl;
+            }
+        }
+    };
+
+    "PTN Lexer Bench"_test = []
+    {
+        const std::string ptnFile = "games/TiltakVsTakoSize6.ptn";
+        const double megabytes = static_cast<double>(std::filesystem::file_size(ptnFile)) / (1 << 20);
+
+        // Line by line, as readGames used to
+        auto before = timeInMics();
+        Lexer lexer;
+        std::vector<Token> tokens;
+        std::ifstream fileStream(ptnFile);
+        std::string line;
+        while (getline(fileStream, line))
+        {
+            const auto lineTokens = lexer.tokenise(line);
+            tokens.insert(tokens.end(), lineTokens.begin(), lineTokens.end());
+        }
+        auto after = timeInMics();
+        std::cout << "Lexer read " << tokens.size() << " tokens at " << megabytes * micsInSecond / (after - before)
+                  << " MB/s" << std::endl;
+
+        before = timeInMics();
+        MappedFile file(ptnFile);
+        StreamLexer streamLexer(file.getText());
+        std::vector<TokenView> tokenViews;
+        for (auto token = streamLexer.next(); token.mType != TokenType::End; token = streamLexer.next())
+            tokenViews.push_back(token);
+        after = timeInMics();
+        std::cout << "StreamLexer read " << tokenViews.size() << " tokens at "
+                  << megabytes * micsInSecond / (after - before) << " MB/s" << std::endl;
+
+        expect(std::ranges::equal(tokens, tokenViews, [](const Token& token, const TokenView& tokenView)
+                                  { return token.mType == tokenView.mType && token.mValue == tokenView.mValue; }));
+
+        before = timeInMics();
+        std::streambuf* coutBuffer = std::cout.rdbuf(nullptr); // Game prints every game it reads
+        const auto games = readGames(ptnFile);
+        std::cout.rdbuf(coutBuffer);
+        std::cout.clear();
+        after = timeInMics();
+        std::cout << "readGames read " << games.size() << " games at " << megabytes * micsInSecond / (after - before)
+                  << " MB/s" << std::endl;
+    };
+#endif
+
     "Stacky Perft"_test = []
     {
         Game game(7);
@@ -0,0 +1,90 @@
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Weverything"
+#include "boost/ut.hpp"
+#pragma clang diagnostic pop
+
+#include "tak/Position.h"
+#include "tak/Tps.h"
+#include "tak/Game.h"
+#include "engine/EndgameSolver.h"
+#include "other/StringOps.h"
+#include "other/Time.h"
+
+int main()
+{
+    using namespace boost::ut;
+
+    "Test Last Flat"_test = []
+    {
+        // White has one flat left, and placing it wins on flats without komi
+        std::string tps = "x5/x3,11112C,21C/x3,111111,2/x3,111111,2/x3,1111,2 1 39";
+        EndgameSolver solver;
+
+        Game noKomiGame = gameFromTps(tps, 0);
+        expect(EndgameSolver::countPlacementsLeft(noKomiGame.getPosition()) == 1_u);
+        auto endgame = solver.solve(noKomiGame.getPosition());
+        expect(endgame.mStatus == EndgameStatus::Win);
+        expect(endgame.mDepth == 1_i);
+        noKomiGame.play(moveToPtn(endgame.mMove, 5));
+        expect(noKomiGame.checkResult() == Result::WhiteFlat);
+
+        // With a point of komi white has to gain a flat with a spread first
+        Game komiGame = gameFromTps(tps, 1);
+        endgame = solver.solve(komiGame.getPosition());
+        expect(endgame.mStatus == EndgameStatus::Win);
+        expect(endgame.mDepth == 3_i);
+        expect(endgame.mMove.mDirection != Direction::None);
+    };
+
+    "Test Road In One"_test = []
+    {
+        // Nowhere near the end of the flat race, but a road in one is still a win we need a move for
+        Game game = gameFromTps("x5/x5/x5/2,2,2,x2/1,1,1,1,x 1 5", 0);
+        EndgameSolver solver;
+        auto endgame = solver.solve(game.getPosition());
+        expect(endgame.mStatus == EndgameStatus::Win);
+        expect(endgame.mDepth == 1_i);
+        game.play(moveToPtn(endgame.mMove, 5));
+        expect(game.checkResult() == Result::WhiteRoad);
+    };
+
+    "Test Flat Loss"_test = []
+    {
+        // games/FlatLoss.ptn, which black won by gaining a flat with 3e5<3 before placing their last flat
+        std::string moves = "a5 e1 e3 d4 e4 e2 e5 d2 d3 b2 1d3-1 1e2+1 d3 e2 d1 c2 d5 1d4-1 Cc3 2d3-2 1c3-1 3d2-3 c1 "
+                            "4d1<4 d1 5c1>5 c1 1e2-1 e2 c4 1e2-1 Cd3 1c1>1 1d2-1 2e1<2 Sc1 1c2-1 c3 2c1+2 Sc1 5d1>5 "
+                            "Se2 3d1+3 1e2-1 e2 1d3-1 d3 1c1>1 d4 5e1+23 a3 b3 a2 c5 1d4<1 1c3+1 3c2+3 b5 c2 3e3+12 "
+                            "3c3+3 b1 1a2>1 4d2<31 1a3>1 3b2+12 Sb2 Sd2 4c2+4 3b3>12 b3";
+
+        Game game(5);
+        for (const auto& move : split(moves, ' '))
+            game.play(move);
+
+        // Far more nodes than we check the clock after, so a deadline already gone stops it early
+        EndgameSolver solver;
+        auto endgame = solver.solve(game.getPosition(), timeInMics() - 1);
+        expect(endgame.mStatus == EndgameStatus::Unknown);
+        expect(endgame.mNodes <= 256_u);
+
+        // The deadline and the records it cut short are only for that solve
+        endgame = solver.solve(game.getPosition());
+        expect(endgame.mStatus == EndgameStatus::Win);
+        expect(moveToPtn(endgame.mMove, 5) == "3e5<3");
+        expect(endgame.mNodes > 256_u) << endgame.mNodes;
+
+        // Once black has played it, white can't stop black placing the last flat
+        game.play("3e5<3");
+        endgame = solver.solve(game.getPosition());
+        expect(endgame.mStatus == EndgameStatus::Loss);
+    };
+
+    "Test Node Budget"_test = []
+    {
+        std::string tps = "x5/x3,11112C,21C/x3,111111,2/x3,111111,2/x3,1111,2 1 39";
+        Game komiGame = gameFromTps(tps, 1);
+
+        EndgameSolver solver(1 << 10, 10);
+        auto endgame = solver.solve(komiGame.getPosition());
+        expect(endgame.mStatus == EndgameStatus::Unknown);
+    };
+}
@@ -23,6 +23,12 @@ int lastSquareEvaluate(const Position& pos)
         return 1;
 }
 
+// Forces the engine onto the search which checks its evaluator and switches at runtime
+int wrappedEvaluate(const Position& pos)
+{
+    return evaluate(pos);
+}
+
 int main()
 {
     rootLogger.setLogToStdOut(true);
@@ -35,6 +41,7 @@ int main()
         options.mUseAlphaBeta = false;
         options.mUseMoveOrdering = false;
         options.mUseTranspositionTable = false;
+        options.mUseTinueSolver = false;
         options.mEvaluator = &lastSquareEvaluate;
 
         Engine engine(options);
@@ -98,6 +105,24 @@ int main()
 
     };
 
+    "Test Quiescence Blocks Past Horizon"_test = []
+    {
+        Engine engine;
+        Game game(4);
+
+        std::string movesTillTak = "d4 a1 a2 d3 a3";
+        for (const auto& move : split(movesTillTak, ' '))
+            game.play(move);
+
+        // Without quiescence we need depth 2 to see the threat, with it depth 1 is enough
+        checkEngineBlocksWin(searchToDepth(engine, game.getPosition(), 1), game);
+        expect(engine.getStats().mQuiescenceNodes > 0);
+
+        game.play("b1");
+        game.play("d2");
+        checkEngineBlocksWin(searchToDepth(engine, game.getPosition(), 1), game);
+    };
+
     "Test Easy Tinue"_test = []
     {
         Engine engine;
@@ -130,6 +155,161 @@ int main()
         auto engineWinningMove = searchToDepth(engine, game.getPosition(), 3);
         expect(engineWinningMove == onlyWinningMove);
     };
+    "Test Pruning Switches"_test = []
+    {
+        EngineOptions prunedOptions;
+        EngineOptions unprunedOptions;
+        unprunedOptions.mUseNullMove = false;
+        unprunedOptions.mUseLateMoveReductions = false;
+        prunedOptions.mUseTinueSolver = unprunedOptions.mUseTinueSolver = false; // We're testing the main search here
+
+        Engine prunedEngine(prunedOptions);
+        Engine unprunedEngine(unprunedOptions);
+        Game game(4);
+
+        std::string movesTillTinue = "a1 d4 b1 a2 c1 a3 1b1<1 b1 d1 b2 2a1>2 a1 a4 b4 3b1<";
+        for (const auto& move : split(movesTillTinue, ' '))
+            game.play(move);
+
+        // Both engines should find the only tinue, but only the pruned engine should have pruned anything
+        for (int depth = 3; depth <= 5; ++depth)
+        {
+            expect(searchToDepth(prunedEngine, game.getPosition(), depth) == "1a2-1");
+            expect(searchToDepth(unprunedEngine, game.getPosition(), depth) == "1a2-1");
+
+            const auto& unprunedStats = unprunedEngine.getStats();
+            expect(unprunedStats.mNullMoveCutoffs == 0 && unprunedStats.mReducedSearches == 0);
+            expect(prunedEngine.getStats().mSeenNodes <= unprunedStats.mSeenNodes);
+        }
+    };
+
+    "Test Evaluation Cache"_test = []
+    {
+        EngineOptions cachedOptions;
+        EngineOptions uncachedOptions;
+        uncachedOptions.mEvaluationCacheSize = 0;
+        cachedOptions.mUseTinueSolver = uncachedOptions.mUseTinueSolver = false;
+
+        Engine cachedEngine(cachedOptions);
+        Engine uncachedEngine(uncachedOptions);
+        Game game(5);
+
+        std::string moves = "a1 e5 c3 c2 d3 b3 d2 d4 c4 c2>";
+        for (const auto& move : split(moves, ' '))
+            game.play(move);
+
+        // The cache only saves work, so both engines should search exactly the same tree
+        // Nothing transposes until one player has moved twice, so we start at depth 3
+        for (int depth = 3; depth <= 5; ++depth)
+        {
+            expect(searchToDepth(cachedEngine, game.getPosition(), depth) ==
+                   searchToDepth(uncachedEngine, game.getPosition(), depth));
+
+            const auto& cachedStats = cachedEngine.getStats();
+            const auto& uncachedStats = uncachedEngine.getStats();
+            expect(cachedStats.mSeenNodes == uncachedStats.mSeenNodes);
+            expect(cachedStats.mEvaluatedNodes == uncachedStats.mEvaluatedNodes);
+            expect(cachedStats.mEvalCacheHits > 0_u);
+            expect(uncachedStats.mEvalCacheHits == 0_u);
+        }
+    };
+
+    "Test Search Dispatch"_test = []
+    {
+        EngineOptions defaultOptions;
+        EngineOptions configuredOptions;
+        configuredOptions.mEvaluator = &wrappedEvaluate;
+        defaultOptions.mUseTinueSolver = configuredOptions.mUseTinueSolver = false;
+
+        Engine defaultEngine(defaultOptions);
+        Engine configuredEngine(configuredOptions);
+        Game game(5);
+
+        std::string moves = "a1 e5 c3 c2 d3 b3 d2 d4 c4 c2>";
+        for (const auto& move : split(moves, ' '))
+            game.play(move);
+
+        // Compiling the evaluator and switches in should change how fast we search, not what we search
+        for (int depth = 1; depth <= 4; ++depth)
+        {
+            expect(searchToDepth(defaultEngine, game.getPosition(), depth) ==
+                   searchToDepth(configuredEngine, game.getPosition(), depth));
+            expect(defaultEngine.getStats().mSeenNodes == configuredEngine.getStats().mSeenNodes);
+            expect(defaultEngine.getStats().mQuiescenceNodes == configuredEngine.getStats().mQuiescenceNodes);
+        }
+    };
+
+    "Test Monte Carlo Engine"_test = []
+    {
+        EngineOptions options;
+        options.mUseMonteCarlo = true;
+        options.mUseTinueSolver = false;
+        options.mUseEndgameSolver = false;
+        options.mLeafEvaluation = LeafEvaluation::Evaluate;
+        Engine engine(options);
+
+        // Black threatens a road on the a file
+        Game game(5);
+        for (const auto& move : split("a1 e5 b2 a2 c3 a3 d4 a4", ' '))
+            game.play(move);
+
+        // Playouts are unlimited, so returning at all means the search kept to its stop time
+        auto move = engine.chooseMove(game.getPosition(), 0.5);
+
+        const auto& stats = engine.getStats();
+        expect(stats.mPlayouts > 0_u);
+        expect(stats.mTreeNodes > 1_u);
+        expect(stats.mTreeMemory > 0_u);
+        expect(stats.mSeenNodes == 0_u); // Negamax never ran
+
+        game.play(move);
+        expect(!game.getPosition().hasRoadInOne(Player::Black)) << move;
+
+        // Black's reply starts from a node of the tree we just grew, which the engine kept for it
+        game.play(engine.chooseMove(game.getPosition(), 0.2));
+        expect(engine.getStats().mPlayouts > 0_u);
+        expect(game.checkResult() == Result::None);
+    };
+
+    "Test Size Weights"_test = []
+    {
+        EngineOptions defaultOptions;
+        EngineOptions configuredOptions;
+        configuredOptions.mEvaluator = &wrappedEvaluate;
+        defaultOptions.mUseTinueSolver = configuredOptions.mUseTinueSolver = false;
+
+        Engine defaultEngine(defaultOptions);
+        Engine configuredEngine(configuredOptions);
+
+        Game fives(5);
+        for (const auto& move : split("a1 e5 c3 c2 d3 b3 d2 d4 c4 c2>", ' '))
+            fives.play(move);
+        Game sixes(6);
+        for (const auto& move : split("a1 f6 c3 d4 c4 d3 d5 c5", ' '))
+            sixes.play(move);
+
+        // Only 5s should see these, and the sized searches should pick them up as they change
+        const auto originalWeights = gEvaluationWeights;
+        gEvaluationWeights[5] = EvaluationWeights{2, 30, 1, 5, 0, 3, 12, 4, 2, 6, 9};
+        const int sixesScore = evaluate(sixes.getPosition());
+        expect(evaluate(sixes.getPosition()) == evaluateWithWeights(sixes.getPosition(), originalWeights[6]));
+        expect(evaluate(fives.getPosition()) != evaluateWithWeights(fives.getPosition(), originalWeights[5]));
+
+        // The engines swap searches as the size changes, and the sized one looks its weights up at compile time
+        for (const Game* game : {&fives, &sixes, &fives})
+        {
+            for (int depth = 1; depth <= 3; ++depth)
+            {
+                expect(searchToDepth(defaultEngine, game->getPosition(), depth) ==
+                       searchToDepth(configuredEngine, game->getPosition(), depth));
+                expect(defaultEngine.getStats().mSeenNodes == configuredEngine.getStats().mSeenNodes);
+            }
+        }
+
+        gEvaluationWeights = originalWeights;
+        expect(evaluate(sixes.getPosition()) == sixesScore);
+    };
+
     "Test Avoid Suicide"_test = []
     {
         Engine engine;
@@ -0,0 +1,275 @@
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Weverything"
+#include "boost/ut.hpp"
+#pragma clang diagnostic pop
+
+#include "tak/Position.h"
+#include "tak/Game.h"
+#include "engine/MonteCarlo.h"
+#include "other/StringOps.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+Game playMoves(std::size_t size, const std::string& moves)
+{
+    Game game(size);
+    for (const auto& move : split(moves, ' '))
+        game.play(move);
+
+    return game;
+}
+
+static constexpr int64_t noTimeLimit = std::numeric_limits<int64_t>::max();
+
+int main()
+{
+    using namespace boost::ut;
+
+    "Test Arena Tree"_test = []
+    {
+        MonteCarlo monteCarlo(1 << 16);
+        Game game(3);
+        monteCarlo.search(game.getPosition(), 5000, noTimeLimit);
+        expect(monteCarlo.getPlayouts() == 5000_u);
+
+        const auto& nodes = monteCarlo.getNodes();
+        const auto* arena = nodes.data();
+        expect(nodes[0].mPlayCount == 5000_u);
+        expect(nodes[0].mChildCount == game.getPosition().generateMoves().size());
+
+        // Nothing else shares the root's children, so every playout went through exactly one of them
+        uint32_t rootChildPlays = 0;
+        for (uint32_t child = nodes[0].mFirstChild; child < nodes[0].mFirstChild + nodes[0].mChildCount; ++child)
+            rootChildPlays += nodes[child].mPlayCount;
+        expect(rootChildPlays == 5000_u);
+
+        // Each child range was made under the node first expanded with it, other nodes for its position share it
+        std::size_t sharedRanges = 0;
+        for (uint32_t index = 0; index < nodes.size(); ++index)
+        {
+            const auto& node = nodes[index];
+            if (node.mState != MonteCarloNode::State::Expanded)
+                continue;
+
+            expect(node.mFirstChild + node.mChildCount <= nodes.size());
+            if (nodes[node.mFirstChild].mParent != index)
+            {
+                ++sharedRanges;
+                continue;
+            }
+
+            for (uint32_t child = node.mFirstChild; child < node.mFirstChild + node.mChildCount; ++child)
+                expect(nodes[child].mParent == index);
+        }
+        expect(sharedRanges > 0_u) << "a1 c3 b1 and b1 c3 a1 should have met";
+
+        // Searching the same position again carries on with the same tree in the same memory
+        monteCarlo.search(game.getPosition(), 500, noTimeLimit);
+        expect(monteCarlo.getNodes().data() == arena);
+        expect(monteCarlo.getNodes()[0].mPlayCount == 5500_u);
+    };
+
+    "Test Tree Reuse"_test = []
+    {
+        MonteCarlo monteCarlo(1 << 20);
+        Game game = playMoves(5, "a1 e5 c3");
+        auto move = monteCarlo.search(game.getPosition(), 20000, noTimeLimit);
+        const auto previousNodeCount = monteCarlo.getNodes().size();
+
+        // The reply we looked at most, after the move we chose
+        auto mostPlayed = [](std::span<const MonteCarloNode> nodes, const MonteCarloNode& parent)
+        {
+            auto children = nodes.subspan(parent.mFirstChild, parent.mChildCount);
+            return *std::max_element(children.begin(), children.end(),
+                                     [](const auto& a, const auto& b) { return a.mPlayCount < b.mPlayCount; });
+        };
+        const auto& nodes = monteCarlo.getNodes();
+        const auto moveNode = mostPlayed(nodes, nodes[0]);
+        expect(moveNode.mMove == move);
+        const auto replyNode = mostPlayed(nodes, moveNode);
+        expect(replyNode.mState == MonteCarloNode::State::Expanded);
+
+        game.play(moveToPtn(move, 5));
+        game.play(moveToPtn(replyNode.mMove, 5));
+        monteCarlo.search(game.getPosition(), 1000, noTimeLimit);
+        const auto& reused = monteCarlo.getNodes();
+        expect(reused[0].mPlayCount == replyNode.mPlayCount + 1000) << replyNode.mPlayCount;
+        expect(reused.size() < previousNodeCount);
+
+        // Everything left hangs off the new root, with its moves legal from the position it was reached from
+        std::vector<bool> reached(reused.size());
+        reached[0] = true;
+        for (uint32_t index = 0; index < reused.size(); ++index)
+        {
+            const auto& node = reused[index];
+            if (index > 0)
+            {
+                expect(reached[index]) << index;
+                expect(node.mParent < reused.size() && reused[node.mParent].mState == MonteCarloNode::State::Expanded);
+            }
+            if (node.mState != MonteCarloNode::State::Expanded)
+                continue;
+
+            expect(node.mFirstChild + node.mChildCount <= reused.size());
+            for (uint32_t child = node.mFirstChild; child < node.mFirstChild + node.mChildCount; ++child)
+                reached[child] = true;
+        }
+
+        MoveBuffer rootMoves = game.getPosition().generateMoves();
+        for (uint32_t child = reused[0].mFirstChild; child < reused[0].mFirstChild + reused[0].mChildCount; ++child)
+            expect(std::find(rootMoves.begin(), rootMoves.end(), reused[child].mMove) != rootMoves.end());
+
+        // A position the tree never reached starts over
+        Game other = playMoves(5, "a1 e5 a5");
+        monteCarlo.search(other.getPosition(), 1000, noTimeLimit);
+        expect(monteCarlo.getNodes()[0].mPlayCount == 1000_u);
+    };
+
+    "Test Full Arena"_test = []
+    {
+        // Room for the root's children and not much more, so most playouts start from leaves that couldn't expand
+        Game game(4);
+        MonteCarlo monteCarlo(100);
+        auto move = monteCarlo.search(game.getPosition(), 200, noTimeLimit);
+        expect(monteCarlo.getNodes().size() <= 100_u);
+        expect(monteCarlo.getPlayouts() == 200_u);
+        expect(isSet(move));
+    };
+
+    "Test Takes Immediate Win"_test = []
+    {
+        MonteCarlo monteCarlo(1 << 16);
+        // The swap gives white a1, so d1 finishes its road
+        Game game = playMoves(4, "d4 a1 b1 a2 c1 a3");
+        auto move = monteCarlo.search(game.getPosition(), 100000, noTimeLimit);
+        expect(moveToPtn(move, 4) == "d1") << moveToPtn(move, 4);
+        expect(monteCarlo.getPlayouts() < 100000_u); // It returns as soon as it sees the road
+    };
+
+    "Test Potential Moves"_test = []
+    {
+        MonteCarlo monteCarlo(1 << 16);
+        Game game = playMoves(4, "a1 d4 b1");
+        const auto& position = game.getPosition();
+        MoveBuffer potentialMoves{Move(2, StoneType::Flat), Move(5, StoneType::Flat)};
+
+        auto move = monteCarlo.search(position, 300, noTimeLimit, potentialMoves);
+        expect(std::find(potentialMoves.begin(), potentialMoves.end(), move) != potentialMoves.end());
+        expect(monteCarlo.getNodes()[0].mChildCount == 2_u);
+    };
+
+    "Test Selection"_test = []
+    {
+        // Black threatens a road on the a file, so any move which doesn't block it loses
+        Game game = playMoves(5, "a1 e5 b2 a2 c3 a3 d4 a4");
+        const auto& position = game.getPosition();
+        const auto rootMoves = position.generateMoves().size();
+
+        // UCT tries every move once before it tries any twice
+        MonteCarlo uct(1 << 20, MonteCarloOptions(MonteCarloSelection::Uct));
+        uct.search(position, rootMoves, noTimeLimit);
+        const auto& uctRoot = uct.getNodes()[0];
+        for (uint32_t child = uctRoot.mFirstChild; child < uctRoot.mFirstChild + uctRoot.mChildCount; ++child)
+            expect(uct.getNodes()[child].mPlayCount == 1_u);
+
+        // PUCT's priors are a distribution which favours placing flats next to the action
+        MonteCarlo puct(1 << 20, MonteCarloOptions(MonteCarloSelection::Puct));
+        auto move = puct.search(position, 4000, noTimeLimit);
+        const auto& puctRoot = puct.getNodes()[0];
+        float priorSum = 0.0f;
+        for (uint32_t child = puctRoot.mFirstChild; child < puctRoot.mFirstChild + puctRoot.mChildCount; ++child)
+            priorSum += puct.getNodes()[child].mPrior;
+        expect(std::abs(priorSum - 1.0f) < 1e-4f);
+        expect(scoreMove(position, Move(24, StoneType::Flat)) > scoreMove(position, Move(24, StoneType::Wall)));
+        expect(scoreMove(position, Move(20, StoneType::Flat)) > scoreMove(position, Move(14, StoneType::Flat)));
+
+        // And with the tree guiding the playouts, it finds a block
+        Position nextPosition(position);
+        nextPosition.play(move);
+        expect(!nextPosition.hasRoadInOne(Player::Black)) << moveToPtn(move, 5);
+    };
+
+    "Test Leaf Evaluation"_test = []
+    {
+        // The same threat as above, which every way of valuing leaves should see off
+        Game game = playMoves(5, "a1 e5 b2 a2 c3 a3 d4 a4");
+        const auto& position = game.getPosition();
+
+        EngineOptions engineOptions;
+        engineOptions.mRolloutPlies = 4;
+        engineOptions.mLeafDepth = 2;
+        for (auto leafEvaluation : {LeafEvaluation::Evaluate, LeafEvaluation::Negamax})
+        {
+            engineOptions.mLeafEvaluation = leafEvaluation;
+            MonteCarloOptions options(engineOptions);
+            expect(options.mLeafEvaluation == leafEvaluation);
+            expect(options.mRolloutPlies == 4_u && options.mLeafDepth == 2_i);
+
+            options.mSelection = MonteCarloSelection::Puct;
+            options.mThreadCount = 2;
+            MonteCarlo monteCarlo(1 << 20, options);
+            auto move = monteCarlo.search(position, 2000, noTimeLimit);
+            expect(monteCarlo.getPlayouts() == 2000_u);
+            for (const auto& node : monteCarlo.getNodes())
+                expect(node.mValue >= 0.0f && node.mValue <= static_cast<float>(node.mPlayCount));
+
+            Position nextPosition(position);
+            nextPosition.play(move);
+            expect(!nextPosition.hasRoadInOne(Player::Black)) << moveToPtn(move, 5);
+
+            // The next search carries on with the same leaf searches
+            expect(isSet(monteCarlo.search(nextPosition, 500, noTimeLimit)));
+        }
+
+        // Which are made with the tree, one per thread, so they're in its memory from the start
+        MonteCarloOptions rolloutOptions(MonteCarloSelection::Puct, 0.7f, 2);
+        MonteCarloOptions negamaxOptions = rolloutOptions;
+        negamaxOptions.mLeafEvaluation = LeafEvaluation::Negamax;
+        expect(MonteCarlo(1 << 10, negamaxOptions).getMemoryUsage() ==
+               MonteCarlo(1 << 10, rolloutOptions).getMemoryUsage() + 2 * EvaluationCache().getMemoryUsage());
+
+        // Without any rollout plies a leaf gets the evaluator's win probability rather than a result
+        MonteCarloOptions evaluateOptions(MonteCarloSelection::Uct);
+        evaluateOptions.mLeafEvaluation = LeafEvaluation::Evaluate;
+        MonteCarlo monteCarlo(1 << 20, evaluateOptions);
+        monteCarlo.search(position, 1, noTimeLimit);
+        const float value = monteCarlo.getNodes()[monteCarlo.getNodes()[0].mFirstChild].mValue;
+        expect(value > 0.0f && value < 1.0f) << value;
+    };
+
+    "Test Parallel Search"_test = []
+    {
+        Game game(3);
+        for (auto parallelism : {MonteCarloParallelism::Tree, MonteCarloParallelism::Root})
+        {
+            MonteCarlo monteCarlo(1 << 16, MonteCarloOptions(MonteCarloSelection::Uct, 0.7f, 4, parallelism));
+            auto move = monteCarlo.search(game.getPosition(), 4000, noTimeLimit);
+            expect(isSet(move));
+            expect(monteCarlo.getPlayouts() == 4000_u);
+
+            // Every virtual loss was made good, and the root trees' playouts were added into ours
+            const auto& nodes = monteCarlo.getNodes();
+            uint32_t rootChildPlays = 0;
+            for (uint32_t child = nodes[0].mFirstChild; child < nodes[0].mFirstChild + nodes[0].mChildCount; ++child)
+                rootChildPlays += nodes[child].mPlayCount;
+            expect(nodes[0].mPlayCount == 4000_u);
+            expect(rootChildPlays == 4000_u);
+            for (const auto& node : nodes)
+                expect(node.mValue <= static_cast<float>(node.mPlayCount));
+        }
+
+        // Root parallel trees split the arena between them
+        MonteCarloOptions rootOptions(MonteCarloSelection::Uct, 0.7f, 4, MonteCarloParallelism::Root);
+        MonteCarlo rootParallel(1 << 16, rootOptions);
+        rootParallel.search(game.getPosition(), 4000, noTimeLimit);
+        expect(rootParallel.getNodes().size() <= (1u << 14));
+
+        // And still take an immediate win
+        MonteCarlo treeParallel(1 << 16, MonteCarloOptions(MonteCarloSelection::Puct, 0.7f, 4));
+        Game winning = playMoves(4, "d4 a1 b1 a2 c1 a3");
+        expect(moveToPtn(treeParallel.search(winning.getPosition(), 100000, noTimeLimit), 4) == "d1");
+        expect(treeParallel.getPlayouts() < 100000_u);
+    };
+}
@@ -3,10 +3,12 @@
 #include "boost/ut.hpp"
 #pragma clang diagnostic pop
 
+#include <map>
 #include <set>
 
 #include "tak/Position.h"
 #include "tak/Game.h" // Game is basically the interface to Position
+#include "other/Xoshiro.h"
 
 #include "utility.h"
 
@@ -84,4 +86,41 @@ int main()
         expect(fullShiftingPerft(pos, 2) == 11'206);
         expect(fullShiftingPerft(pos, 3) == 957'000);
     };
-}
\ No newline at end of file
+
+    "Sample Move"_test = []
+    {
+        // The opening swap, a cap which can smash a wall, and the big stack above
+        const std::vector<std::vector<std::string>> games = {
+            {},
+            {"a1", "e5", "Cc3", "Sd3"},
+            {"c4", "c2", "d2", "c3", "b2", "d3", "1d2+", "b3", "d2", "b4", "1c2+", "1b3>", "2d3<", "1c4-",
+             "d4", "5c3<23", "c2", "c4", "1d4<", "d3", "1d2+", "1c3+", "Cc3", "2c4>", "1c3<", "d2", "c3",
+             "1d2+", "1c3+", "1b4>", "2b3>11", "3c4-12", "d2", "c4", "b4", "c5", "1b3>", "1c4<", "3c3-", "e5", "e2"},
+        };
+
+        Xoshiro256 random(1);
+        for (const auto& moves : games)
+        {
+            Game game(5);
+            for (const auto& move : moves)
+                game.play(move);
+            const Position& pos = game.getPosition();
+
+            // Every move generateMoves makes should come up about as often as every other
+            std::map<std::string, std::size_t> counts;
+            for (const auto& move : pos.generateMoves())
+                counts[moveToPtn(move, 5)] = 0;
+
+            constexpr std::size_t samplesPerMove = 200;
+            for (std::size_t sample = 0; sample < samplesPerMove * counts.size(); ++sample)
+            {
+                auto ptn = moveToPtn(pos.sampleMove(random()), 5);
+                expect(counts.contains(ptn)) << ptn;
+                ++counts[ptn];
+            }
+
+            for (const auto& [ptn, count] : counts)
+                expect(count > samplesPerMove / 2 && count < samplesPerMove * 3 / 2) << ptn << count;
+        }
+    };
+}
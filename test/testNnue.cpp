@@ -0,0 +1,120 @@
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Weverything"
+#include "boost/ut.hpp"
+#pragma clang diagnostic pop
+
+#include "tak/Game.h"
+#include "tak/Position.h"
+#include "engine/Engine.h"
+#include "engine/Nnue.h"
+#include "other/StringOps.h"
+
+#include <filesystem>
+#include <fstream>
+
+int main()
+{
+    using namespace boost::ut;
+
+    // games/FlatLoss.ptn, which goes to a full board with plenty of tall stacks
+    const std::string moves = "a5 e1 e3 d4 e4 e2 e5 d2 d3 b2 1d3-1 1e2+1 d3 e2 d1 c2 d5 1d4-1 Cc3 2d3-2 1c3-1 3d2-3 c1 "
+                              "4d1<4 d1 5c1>5 c1 1e2-1 e2 c4 1e2-1 Cd3 1c1>1 1d2-1 2e1<2 Sc1 1c2-1 c3 2c1+2 Sc1 5d1>5 "
+                              "Se2 3d1+3 1e2-1 e2 1d3-1 d3 1c1>1 d4 5e1+23 a3 b3 a2 c5 1d4<1 1c3+1 3c2+3 b5 c2 3e3+12 "
+                              "3c3+3 b1 1a2>1 4d2<31 1a3>1 3b2+12 Sb2 Sd2 4c2+4 3b3>12 b3 3e5<3";
+
+    gNnueNetwork.randomise(1);
+
+    "Test Incremental Accumulator"_test = [&]
+    {
+        // Going back and forth between boards and sizes, as a search's evaluations would
+        NnueAccumulatorCache cache;
+        Game game(5);
+        for (const auto& ptn : split(moves, ' '))
+        {
+            game.play(ptn);
+            const Position& position = game.getPosition();
+            expect(gNnueNetwork.accumulate(position, cache) == gNnueNetwork.accumulate(position)) << ptn;
+
+            Position shifted = position.shift(Shift::RotateClockwise);
+            expect(gNnueNetwork.accumulate(shifted, cache) == gNnueNetwork.accumulate(shifted)) << ptn;
+
+            Game sixes(6);
+            expect(gNnueNetwork.accumulate(sixes.getPosition(), cache) == NnueAccumulator{}) << ptn;
+        }
+
+        expect(gNnueNetwork.accumulate(game.getPosition()) != NnueAccumulator{});
+    };
+
+    "Test New Weights Refresh Caches"_test = [&]
+    {
+        NnueNetwork network;
+        network.randomise(2);
+
+        NnueAccumulatorCache cache;
+        Game game(5);
+        for (const auto& ptn : split(moves, ' '))
+        {
+            game.play(ptn);
+            network.accumulate(game.getPosition(), cache);
+        }
+
+        network.randomise(3);
+        expect(network.accumulate(game.getPosition(), cache) == network.accumulate(game.getPosition()));
+
+        // Another network with the same board doesn't get this one's accumulator either
+        expect(gNnueNetwork.accumulate(game.getPosition(), cache) == gNnueNetwork.accumulate(game.getPosition()));
+    };
+
+    "Test Kernels Agree"_test = [&]
+    {
+        Game game(5);
+        for (const auto& ptn : split(moves, ' '))
+        {
+            game.play(ptn);
+            const Position& position = game.getPosition();
+            expect(gNnueNetwork.evaluate(position, NnueKernel::Avx2) ==
+                   gNnueNetwork.evaluate(position, NnueKernel::Scalar))
+                << ptn;
+        }
+    };
+
+    "Test Save And Load"_test = [&]
+    {
+        const std::string path = (std::filesystem::temp_directory_path() / "testNnue.nnue").string();
+        expect(gNnueNetwork.save(path));
+
+        // A network with different weights, until it loads ours
+        NnueNetwork network;
+        network.randomise(2);
+        expect(network.load(path));
+
+        Game game(5);
+        bool anyNonZero = false;
+        for (const auto& ptn : split(moves, ' '))
+        {
+            game.play(ptn);
+            const int score = gNnueNetwork.evaluate(game.getPosition());
+            expect(network.evaluate(game.getPosition()) == score) << ptn;
+            anyNonZero |= score != 0;
+        }
+        expect(anyNonZero);
+
+        // Truncated files and other networks' files are rejected
+        std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+        expect(!network.load(path));
+        std::ofstream(path, std::ios::binary) << "TAKNNUE0";
+        expect(!network.load(path));
+        std::filesystem::remove(path);
+    };
+
+    "Test Engine With Network"_test = []
+    {
+        Game game(5);
+        game.play("a1");
+        game.play("e5");
+
+        Engine engine(EngineOptions(true, true, false, 3, "", &nnueEvaluate));
+        game.play(engine.chooseMove(game.getPosition(), 1e6, 3));
+        expect(game.getMoveList().size() == 3_u);
+    };
+}
@@ -7,6 +7,11 @@
 #include "tak/Position.h"
 #include "engine/Engine.h"
 #include "tak/Game.h" // Game is basically the interface to Position
+#include "other/StringOps.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
 
 int main()
 {
@@ -49,4 +54,171 @@ int main()
         game.play("c3");
         expect(!engine.openingBookContains(game.getPosition()));
     };
+
+    "Compiled opening book"_test = []
+    {
+        const std::string path = (std::filesystem::temp_directory_path() / "testOpeningBook.book").string();
+        OpeningBookBuilder builder(6);
+        std::ifstream lines("test/Openings.txt");
+        std::string line;
+        while (getline(lines, line))
+        {
+            if (!line.empty())
+                expect(builder.addLine(line)) << line;
+        }
+        expect(builder.write(path));
+
+        // Every position the text book knows, the compiled one knows with the same moves
+        OpeningBook textBook("test/Openings.txt");
+        OpeningBook compiledBook(path);
+        expect(compiledBook.positionCount() == builder.positionCount());
+        expect(compiledBook.positionCount() == textBook.positionCount());
+
+        std::ifstream replay("test/Openings.txt");
+        while (getline(replay, line))
+        {
+            Game game(6);
+            for (const auto& move : split(line, ' '))
+            {
+                const Position& position = game.getPosition();
+                const Position canonicalPosition = position.shift(position.getCanonicalShift());
+                expect(compiledBook.contains(canonicalPosition)) << line;
+                expect(std::ranges::equal(compiledBook.getResponses(canonicalPosition),
+                                          textBook.getResponses(canonicalPosition),
+                                          [](const BookMove& a, const BookMove& b)
+                                          { return a.mMove == b.mMove && a.mWeight == b.mWeight; }));
+                game.play(move);
+            }
+        }
+
+        // Compiled books are for one komi, and the wrong length is no book at all
+        expect(!compiledBook.contains(Game(6, 2).getPosition()));
+        std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+        expect(OpeningBook(path).positionCount() == 0_u);
+        std::filesystem::remove(path);
+    };
+
+    "Book spreads turn with the board"_test = []
+    {
+        // A stack off in a corner, so the position is canonical a different way round from how we play it
+        Game game(5);
+        for (const auto& move : split("a1 e5 b1 e4 a1>", ' '))
+            game.play(move);
+        const Position& position = game.getPosition();
+        expect(position.getCanonicalShift() != Shift::Identical);
+
+        for (const auto& move : position.generateMoves())
+        {
+            OpeningBookBuilder builder(5);
+            builder.add(position, move);
+            std::vector<BookPosition> positions;
+            std::vector<BookMove> moves;
+            builder.compile(positions, moves);
+
+            // Playing the stored move in the canonical position gets the same position as playing ours, turned
+            const Shift shift = position.getCanonicalShift();
+            Position played(position);
+            played.play(move);
+            Position canonicalPlayed = position.shift(shift);
+            canonicalPlayed.play(moves[0].mMove);
+            expect(canonicalPlayed == played.shift(shift)) << moveToPtn(move, 5);
+        }
+    };
+
+    "Merged builders tally like one"_test = []
+    {
+        // What bookbuilder's threads do, each with some of the games
+        const Position start(6);
+        const Move a1 = start.ptnToMove(PtnTurn("a1"));
+        const Move c3 = start.ptnToMove(PtnTurn("c3"));
+        OpeningBookBuilder first(6), second(6), merged(6);
+        first.add(start, a1, 1.0f);
+        first.add(start, c3, 0.0f);
+        second.add(start, a1, 0.0f);
+        second.add(start, a1, 0.5f);
+        merged.merge(first);
+        merged.merge(second);
+
+        std::vector<BookPosition> positions;
+        std::vector<BookMove> moves;
+        merged.compile(positions, moves);
+        expect(positions.size() == 1_u && moves.size() == 2_u);
+        expect(moves[0].mMove == a1 && moves[0].mWeight == 3_u && moves[0].mScore == 0.5_f);
+        expect(moves[1].mMove == c3 && moves[1].mWeight == 1_u && moves[1].mScore == 0.0_f);
+
+        merged.prune(2);
+        merged.compile(positions, moves);
+        expect(positions.size() == 1_u && moves.size() == 1_u && moves[0].mMove == a1);
+        merged.prune(4);
+        expect(merged.positionCount() == 0_u);
+    };
+
+    "Book selection"_test = []
+    {
+        const Position start(6);
+        const Move a1 = start.ptnToMove(PtnTurn("a1"));
+        const Move b1 = start.ptnToMove(PtnTurn("b1"));
+        const Move c3 = start.ptnToMove(PtnTurn("c3"));
+        OpeningBookBuilder builder(6);
+        for (int game = 0; game < 30; ++game)
+            builder.add(start, a1, game < 15 ? 1.0f : 0.0f);
+        for (int game = 0; game < 10; ++game)
+            builder.add(start, b1, game < 8 ? 1.0f : 0.0f);
+        builder.add(start, c3, 1.0f);
+
+        std::vector<BookPosition> positions;
+        std::vector<BookMove> moves;
+        builder.compile(positions, moves);
+        const std::span<const BookMove> responses = moves;
+
+        // b1 won 80% of its games, c3 won its only game, which counting a draw too is only 75%
+        Xoshiro256 random(1);
+        expect(OpeningBook::select(responses, BookSelection::BestScore, random).mMove == b1);
+
+        // Weighted picks come out about as often as the moves were played
+        std::size_t picks[3] = {};
+        for (int pick = 0; pick < 41000; ++pick)
+        {
+            const Move move = OpeningBook::select(responses, BookSelection::Weighted, random).mMove;
+            ++picks[move == a1 ? 0 : move == b1 ? 1 : 2];
+        }
+        expect(picks[0] > 29000_u && picks[0] < 31000_u) << picks[0];
+        expect(picks[1] > 9300_u && picks[1] < 10700_u) << picks[1];
+        expect(picks[2] > 700_u && picks[2] < 1300_u) << picks[2];
+
+        // A corrupt book might weigh every move at nothing, which just makes them all as likely
+        const BookMove unweighted[2] = {{a1, 0, 0.5f}, {b1, 0, 0.5f}};
+        std::size_t a1Picks = 0;
+        for (int pick = 0; pick < 1000; ++pick)
+            a1Picks += OpeningBook::select(unweighted, BookSelection::Weighted, random).mMove == a1;
+        expect(a1Picks > 400_u && a1Picks < 600_u) << a1Picks;
+    };
+
+    "Engine plays book spreads whichever way round the board is"_test = []
+    {
+        Game game(5);
+        for (const auto& move : split("a1 e5 b1 e4", ' '))
+            game.play(move);
+        const Position& position = game.getPosition();
+        const auto moves = position.generateMoves();
+        const Move spread = *std::find_if(moves.begin(), moves.end(),
+                                          [](const Move& move) { return move.mDirection != Direction::None; });
+
+        const std::string path = (std::filesystem::temp_directory_path() / "testOpeningBookSpread.book").string();
+        OpeningBookBuilder builder(5);
+        builder.add(position, spread);
+        expect(builder.write(path));
+
+        EngineOptions options;
+        options.mOpeningBookPath = path;
+        Engine engine(options);
+        for (const auto shift : shifts)
+        {
+            const Position shifted = position.shift(shift);
+            const Move expected = position.shiftMove(spread, shift);
+            const auto ptn = engine.chooseMove(shifted, 1.0);
+            expect(shifted.ptnToMove(PtnTurn(ptn)) == expected) << shift << ptn;
+        }
+        std::filesystem::remove(path);
+    };
 }
@@ -5,6 +5,18 @@
 
 #include "tak/Position.h"
 #include "tak/Game.h" // Game is basically the interface to Position
+#include "tak/Tps.h"
+#include "other/StringOps.h"
+
+#ifndef LOW_MEMORY_COMPILE
+#include "other/MappedFile.h"
+#include "ptn/Lexer.h"
+#include "ptn/StreamLexer.h"
+
+#include <fstream>
+#endif
+
+#include <algorithm>
 
 int main()
 {
@@ -38,6 +50,116 @@ int main()
         expect(game.moveCount() == 87);
     };
 
+    // A long, stacky game
+    const std::string stackyGame = "a6 f6 d4 c4 d3 c3 d2 c5 c2 d5 e4 b5 e5 Ce3 f5 e3+ f4 f3 e3 b6 "
+                                   "Cb4 b2 b3 c4> b4+ c4 2b5> c6 3c5- c5 4c4> c4 c1 d5> d6 Sd5 f2 "
+                                   "f3+ b1 e2 a1 2e4- e4 3e3< e3 4d3- f3 d3 5d4< d5- f1 e2> e1 d1 "
+                                   "e2 2d4> d5 a2 d4 c3- c3 2f2< b3- a2> b1+ c5> b3 c5 d6- 2e5< d4+ "
+                                   "c5> Se5 5d5+ e5< 5d6>32 f5+ 3e6> Se6 4f6- e6> 2c2< b3- a2 5b2< "
+                                   "5d2<311 c5 6a2>132 c3- 3b2> 6c4-15 a3 3d5-12 d2+* 3f6-12 3d3>12 "
+                                   "6c2+ b2> d2< 3e2<12 d2< d6 6c2<15 a3- 6c2<51";
+
+    "Road In One"_test = [&]
+    {
+        // Checks every position along a game against playing every legal move
+        auto checkWinningMoves = [](std::size_t size, const std::string& moves)
+        {
+            Game game(size);
+            for (const auto& ptn : split(moves, ' '))
+            {
+                game.play(ptn);
+                const Position& position = game.getPosition();
+                const Player player = position.getPlayer();
+                const Result road = player == Player::White ? Result::WhiteRoad : Result::BlackRoad;
+
+                std::vector<std::string> expected;
+                for (const auto& move : position.generateMoves())
+                {
+                    Position nextPosition(position);
+                    nextPosition.play(move);
+                    if (nextPosition.checkResult() == road)
+                        expected.push_back(moveToPtn(move, size));
+                }
+
+                std::vector<std::string> found;
+                for (const auto& move : position.findWinningMoves(player))
+                    found.push_back(moveToPtn(move, size));
+
+                std::sort(expected.begin(), expected.end());
+                std::sort(found.begin(), found.end());
+                expect(found == expected) << ptn;
+                expect(position.hasRoadInOne(player) == !expected.empty()) << ptn;
+            }
+            return game;
+        };
+
+        checkWinningMoves(6, stackyGame);
+
+        // Black's only road is moving c4 down, which no placement could do
+        Game game = checkWinningMoves(5, "b1 e1 Ca2 a1 Sd4 1b1>1 1d4-1 c4 a3 1a1>1 Sd5 Ca5 1d3>1 1a5>1 Sc3 "
+                                         "1b5-1 d4 Sa4 d2 c2 1a2-1 1b4>1 e2 c5 Sd3");
+        const Position& position = game.getPosition();
+        auto winningMoves = position.findWinningMoves(Player::Black);
+        expect(winningMoves.size() == 1_u);
+        expect(!winningMoves.empty() && moveToPtn(winningMoves.front(), 5) == "1c4-1");
+        expect(position.findRoadPlacements(Player::Black) == 0_u);
+    };
+
+    "Incremental Square Terms"_test = [&]
+    {
+        Game game(6);
+        for (const auto& ptn : split(stackyGame, ' '))
+        {
+            game.play(ptn);
+            const Position& position = game.getPosition();
+            expect(position.getSquareTerms() == position.countSquareTerms()) << ptn;
+
+            Position shifted = position.shift(Shift::RotateClockwise);
+            expect(shifted.getSquareTerms() == shifted.countSquareTerms()) << ptn;
+            expect(shifted.countIslands() == position.countIslands()) << ptn;
+        }
+    };
+
+    "Stack Composition"_test = []
+    {
+        // Black's ten stone stack carries four white stones and buries three more, white's carries one of its own
+        // and two of black's
+        Game game = gameFromTps("x5/x5/x2,2111211112,x2/x5/2211,x4 1 20");
+        const Position& position = game.getPosition();
+        SquareTerms terms = position.countSquareTerms();
+        expect(terms.mReserves == 1_i);
+        expect(terms.mCaptives == -2_i);
+        expect(terms.mHardCaptives == -3_i);
+
+        // On 8s the same stack can carry off all but its bottom two stones, one of black's and one of white's
+        Game bigGame = gameFromTps("x8/x8/x8/x2,2111211112,x5/x8/x8/x8/2211,x7 1 20");
+        SquareTerms bigTerms = bigGame.getPosition().getSquareTerms();
+        expect(bigTerms.mReserves == 0_i);
+        expect(bigTerms.mCaptives == -4_i);
+        expect(bigTerms.mHardCaptives == -1_i);
+    };
+
+    "Road Distances"_test = []
+    {
+        auto distances = [](const std::string& tps) { return gameFromTps(tps).getPosition().countRoadDistances(); };
+
+        auto empty = Game(5).getPosition().countRoadDistances();
+        expect(empty[Player::White] == 5_u && empty[Player::Black] == 5_u);
+
+        // Black's flat can be covered, but its wall and cap send white up around them
+        auto open = distances("x5/x5/x5/x5/1,1,1,1,2 1 4");
+        expect(open[Player::White] == 1_u);
+        expect(open[Player::Black] == 4_u);
+        expect(distances("x5/x5/x5/x5/1,1,1,1,2S 1 4")[Player::White] == 2_u);
+        expect(distances("x5/x5/x5/x5/1,1,1,1,2C 1 4")[Player::White] == 2_u);
+
+        // A finished road is zero, and a cross of walls leaves nobody a road, which counts as one more than the size
+        expect(distances("x5/x5/x5/x5/1,1,1,1,1 2 3")[Player::White] == 0_u);
+        auto walled = distances("x2,2S,x2/x2,2S,x2/2S,2S,2S,2S,2S/x2,2S,x2/1,1,2S,x2 1 10");
+        expect(walled[Player::White] == 6_u);
+        expect(walled[Player::Black] == 6_u);
+    };
+
 #ifndef LOW_MEMORY_COMPILE
     "Basic Flat Win"_test = []
     {
@@ -66,5 +188,42 @@ int main()
         Game game = readGame(ptnFile);
         expect(game.checkResult() == Result::WhiteRoad);
     };
+
+    "Stream lexer matches Lexer"_test = []
+    {
+        for (const std::string ptnFile : {"games/ShortDump.ptn", "games/GaveWin.ptn", "games/StackySevens.ptn",
+                                          "games/LongStackyGame.ptn", "games/DragonClause.ptn"})
+        {
+            Lexer lexer;
+            std::vector<Token> tokens;
+            std::ifstream fileStream(ptnFile);
+            std::string line;
+            while (getline(fileStream, line))
+            {
+                const auto lineTokens = lexer.tokenise(line);
+                tokens.insert(tokens.end(), lineTokens.begin(), lineTokens.end());
+            }
+
+            MappedFile file(ptnFile);
+            StreamLexer streamLexer(file.getText());
+            for (const auto& token : tokens)
+            {
+                const auto tokenView = streamLexer.next();
+                expect(tokenView.mType == token.mType && tokenView.mValue == token.mValue) << ptnFile << token;
+            }
+            expect(streamLexer.next().mType == TokenType::End) << ptnFile;
+        }
+
+        // Spreads, comments and results which run up to the end of the text, and things which aren't PTN at all
+        StreamLexer streamLexer("1. a1 {hello} 6f1<1113C*'! ?? 2. 1/2-1/2");
+        for (const auto& [type, value] : {std::pair{TokenType::PlyNum, "1"}, {TokenType::PlaceMove, "a1"},
+                                          {TokenType::Comment, "hello"}, {TokenType::MoveMove, "6f1<1113C*'!"},
+                                          {TokenType::PlyNum, "2"}, {TokenType::GameResult, "1/2-1/2"}})
+        {
+            const auto tokenView = streamLexer.next();
+            expect(tokenView.mType == type && tokenView.mValue == value) << value;
+        }
+        expect(streamLexer.next().mType == TokenType::End);
+    };
 #endif
 }
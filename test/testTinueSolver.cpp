@@ -0,0 +1,140 @@
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Weverything"
+#include "boost/ut.hpp"
+#pragma clang diagnostic pop
+
+#include "tak/Position.h"
+#include "tak/Game.h"
+#include "engine/TinueSolver.h"
+#include "other/StringOps.h"
+#include "other/Time.h"
+
+Game playMoves(std::size_t size, const std::string& moves)
+{
+    Game game(size);
+    for (const auto& move : split(moves, ' '))
+        game.play(move);
+
+    return game;
+}
+
+int main()
+{
+    using namespace boost::ut;
+
+    "Test Easy Tinue"_test = []
+    {
+        TinueSolver solver;
+
+        // White is threatening a road on the a file, but black can still block it
+        Game game = playMoves(4, "a1 d4 b1 a2 c1 a3");
+        expect(solver.solve(game.getPosition()).mStatus == TinueStatus::NoTinue);
+
+        // After black's only block, only 1a2-1 keeps white threatening two roads at once
+        game.play("1b1<1");
+        game.play("b1");
+        game.play("d1");
+        game.play("b2");
+        game.play("2a1>2");
+        game.play("a1");
+        game.play("a4");
+        game.play("b4");
+        game.play("3b1<");
+
+        auto tinue = solver.solve(game.getPosition());
+        expect(tinue.mStatus == TinueStatus::Tinue);
+        expect(moveToPtn(tinue.mMove, 4) == "1a2-1");
+        expect(tinue.mNodes > 0_u);
+
+        // Once it's a road in one we don't need to search at all
+        game.play("1a2-1");
+        game.play("Sa2");
+        tinue = solver.solve(game.getPosition());
+        expect(tinue.mStatus == TinueStatus::Tinue);
+        expect(moveToPtn(tinue.mMove, 4) == "4a1>112");
+        expect(tinue.mNodes == 0_u);
+    };
+
+    "Test 6s Tinue"_test = []
+    {
+        // The same position as the depth 5 tinue search bench
+        Game game = playMoves(6, "a1 b2 c2 b3 d2 e2 c3 Cd3 e3 d1 b4 d4 c4 d5 d6 e2< e2 c6 d6- c5 e5 d6 c2> "
+                                 "d3- d3 2d2+ e2< 3d3- e2 d3 c4+ 6d2+114 c2 2d4-11 c3> 6d5-15 d5 d6- e5< d4+ "
+                                 "2c5> 6d3+15 d4- 6d5- 4d3-22 6d4< Cd3 5d5<221 a2 a1+ a1 2a2> b1 Sc1 b1+ c1+ "
+                                 "4b2+112 2c5< b4+ a5> b4+ Sc5 5b5+ c5< 5b6>122 3b5-12 d5 2c2> d3-* 4b3>13 e4 "
+                                 "6c4>15 e1 6e4-");
+
+        TinueSolver solver;
+        auto tinue = solver.solve(game.getPosition());
+        expect(tinue.mStatus == TinueStatus::Tinue);
+
+        // Whatever black does next, white should still have a tinue (or a road)
+        game.play(moveToPtn(tinue.mMove, 6));
+        for (const auto& reply : game.getPosition().generateMoves())
+        {
+            Position nextPosition(game.getPosition());
+            nextPosition.play(reply);
+            if (nextPosition.checkResult() != Result::None)
+            {
+                expect(nextPosition.checkResult() == Result::WhiteRoad);
+                continue;
+            }
+            expect(solver.solve(nextPosition).mStatus == TinueStatus::Tinue) << moveToPtn(reply, 6);
+        }
+    };
+
+    "Test Tiny Table"_test = []
+    {
+        // With only 7 entries another position overwrites the root's before the search is done, which loses the proof
+        // unless the solver keeps it for itself
+        Game game = playMoves(4, "a1 d4 b1 a2 c1 a3 1b1<1 b1 d1 b2 2a1>2 a1 a4 b4 3b1<");
+        TinueSolver solver(7);
+        auto tinue = solver.solve(game.getPosition());
+        expect(tinue.mStatus == TinueStatus::Tinue);
+        expect(moveToPtn(tinue.mMove, 4) == "1a2-1");
+    };
+
+    "Test Node Budget"_test = []
+    {
+        Game game = playMoves(4, "a1 d4 b1 a2 c1 a3 1b1<1 b1 d1 b2 2a1>2 a1 a4 b4 3b1<");
+
+        TinueSolver solver(1 << 10, 1);
+        auto tinue = solver.solve(game.getPosition());
+        expect(tinue.mStatus == TinueStatus::Unknown);
+        expect(tinue.mNodes == 1_u);
+    };
+
+    "Test Ply Limit"_test = []
+    {
+        // The tinue needs white's reply to every block, which a ply limit of one cuts off, so we can't say either way
+        Game game = playMoves(4, "a1 d4 b1 a2 c1 a3 1b1<1 b1 d1 b2 2a1>2 a1 a4 b4 3b1<");
+        TinueSolver solver(TinueSolver::sDefaultTableSize, 20000, 1);
+        expect(solver.solve(game.getPosition()).mStatus == TinueStatus::Unknown);
+    };
+
+    "Test Defender Ends On Flats"_test = []
+    {
+        // White can threaten a road with a3, but with the board nearly full black just fills it and wins on flats
+        Game game = playMoves(3, "b1 c1 c3 b2 Sc2 1b1+1 b1 a2 1b1+1 1a2-1 1b2-1 1b2-1 1c3<1 1b2+1 b2 1a1+1 1b2+1 a1");
+        TinueSolver solver;
+        expect(solver.solve(game.getPosition()).mStatus == TinueStatus::NoTinue);
+    };
+
+    "Test Deadline"_test = []
+    {
+        // The same position as Test 6s Tinue, which takes far more nodes than we check the clock after
+        Game game = playMoves(6, "a1 b2 c2 b3 d2 e2 c3 Cd3 e3 d1 b4 d4 c4 d5 d6 e2< e2 c6 d6- c5 e5 d6 c2> "
+                                 "d3- d3 2d2+ e2< 3d3- e2 d3 c4+ 6d2+114 c2 2d4-11 c3> 6d5-15 d5 d6- e5< d4+ "
+                                 "2c5> 6d3+15 d4- 6d5- 4d3-22 6d4< Cd3 5d5<221 a2 a1+ a1 2a2> b1 Sc1 b1+ c1+ "
+                                 "4b2+112 2c5< b4+ a5> b4+ Sc5 5b5+ c5< 5b6>122 3b5-12 d5 2c2> d3-* 4b3>13 e4 "
+                                 "6c4>15 e1 6e4-");
+
+        TinueSolver solver;
+        auto tinue = solver.solve(game.getPosition(), timeInMics() - 1);
+        expect(tinue.mStatus == TinueStatus::Unknown);
+        expect(tinue.mNodes <= 256_u);
+
+        // And the deadline is only for that solve
+        expect(solver.solve(game.getPosition()).mStatus == TinueStatus::Tinue);
+    };
+}
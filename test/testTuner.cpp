@@ -0,0 +1,140 @@
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Weverything"
+#include "boost/ut.hpp"
+#pragma clang diagnostic pop
+
+#include "tak/Game.h"
+#include "tak/Position.h"
+#include "engine/Engine.h"
+#include "engine/Tuner.h"
+#include "other/StringOps.h"
+
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+
+int main()
+{
+    using namespace boost::ut;
+
+    // The same 6s game as bench.cpp, which white wins by road with its last move
+    const std::string moves = "a6 f6 d4 c4 d3 c3 d2 c5 c2 d5 e4 b5 e5 Ce3 f5 e3+ f4 f3 e3 b6 "
+                              "Cb4 b2 b3 c4> b4+ c4 2b5> c6 3c5- c5 4c4> c4 c1 d5> d6 Sd5 f2 "
+                              "f3+ b1 e2 a1 2e4- e4 3e3< e3 4d3- f3 d3 5d4< d5- f1 e2> e1 d1 "
+                              "e2 2d4> d5 a2 d4 c3- c3 2f2< b3- a2> b1+ c5> b3 c5 d6- 2e5< d4+ "
+                              "c5> Se5 5d5+ e5< 5d6>32 f5+ 3e6> Se6 4f6- e6> 2c2< b3- a2 5b2< "
+                              "5d2<311 c5 6a2>132 c3- 3b2> 6c4-15 a3 3d5-12 d2+* 3f6-12 3d3>12 "
+                              "6c2+ b2> d2< 3e2<12 d2< d6 6c2<15 a3- 6c2<51 e6 6b2+1113";
+
+    "Test Features Match Evaluate"_test = [&]
+    {
+        for (double komi : {0.0, 2.0, 2.5})
+        {
+            Game game(6, komi);
+            for (const auto& ptn : split(moves, ' '))
+            {
+                game.play(ptn);
+                const Position& position = game.getPosition();
+                auto features = evaluationFeatures(position);
+
+                double score = 0;
+                for (std::size_t index = 0; index < features.size(); ++index)
+                    score += gEvaluationWeights[6].*gEvaluationWeightFields[index].mWeight * features[index];
+
+                // evaluate rounds the komi term towards zero
+                expect(std::abs(score - evaluate(position)) < 1.0) << ptn << komi;
+            }
+        }
+    };
+
+    "Test Save And Load Weights"_test = []
+    {
+        const std::string path = (std::filesystem::temp_directory_path() / "testTuner.weights").string();
+        EvaluationWeights saved{1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+        expect(saveEvaluationWeights(path, saved));
+
+        SizeEvaluationWeights loaded = gEvaluationWeights;
+        expect(loadEvaluationWeights(path, loaded));
+        for (std::size_t size = 3; size <= 8; ++size)
+        {
+            for (const auto& field : gEvaluationWeightFields)
+                expect(loaded[size].*field.mWeight == saved.*field.mWeight) << field.mName << size;
+        }
+
+        // Saving for one size only changes that size's weights
+        EvaluationWeights fives{5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5};
+        expect(saveEvaluationWeights(path, fives, 5));
+        expect(loadEvaluationWeights(path, loaded));
+        expect(loaded[5].mIslandLengthsWeight == 5_i);
+        expect(loaded[6].mIslandLengthsWeight == 7_i);
+
+        // Fields a file leaves out keep their weight, and sections override what came before them
+        std::ofstream(path) << "FlatCount 20\nSize 4\nFlatCount 40\nStoneOnEdge 0\n";
+        expect(loadEvaluationWeights(path, loaded));
+        expect(loaded[4].mFlatCountWeight == 40_i);
+        expect(loaded[4].mStoneOnEdgeWeight == 0_i);
+        expect(loaded[6].mFlatCountWeight == 20_i);
+        expect(loaded[6].mStoneOnEdgeWeight == 6_i);
+        expect(loaded[6].mCapsOnBoardWeight == 3_i);
+
+        // Fields or sizes we don't know fail the whole file
+        std::ofstream(path) << "FlatCount 30\nFlatness 1\n";
+        expect(!loadEvaluationWeights(path, loaded));
+        std::ofstream(path) << "FlatCount 30\nSize 9\n";
+        expect(!loadEvaluationWeights(path, loaded));
+        expect(loaded[6].mFlatCountWeight == 20_i);
+        std::filesystem::remove(path);
+    };
+
+    "Test Quiet Positions"_test = [&]
+    {
+        Game game(6);
+        for (const auto& ptn : split(moves, ' '))
+            game.play(ptn);
+        expect(game.checkResult() == Result::WhiteRoad);
+
+        std::vector<TuningPosition> positions;
+        addTuningPositions(game, positions);
+        expect(!positions.empty());
+        expect(positions.size() < game.getMoveList().size()); // Some of the end is roads in one
+        for (const auto& position : positions)
+            expect(position.mResult == 1.0_f);
+
+        // Unfinished games don't tell us anything
+        const std::size_t finishedCount = positions.size();
+        Game unfinished(6);
+        unfinished.play("a1");
+        unfinished.play("f6");
+        addTuningPositions(unfinished, positions);
+        expect(positions.size() == finishedCount);
+    };
+
+    "Test Tuning Lowers Loss"_test = []
+    {
+        // White wins when it has more flats, whatever its stack control says
+        std::vector<TuningPosition> positions;
+        for (int flats = -5; flats <= 5; ++flats)
+        {
+            for (int stacks = -3; stacks <= 3; ++stacks)
+            {
+                TuningPosition position{};
+                position.mFeatures[1] = static_cast<float>(flats);
+                position.mFeatures[3] = static_cast<float>(stacks);
+                position.mResult = flats > 0 ? 1.0f : flats < 0 ? 0.0f : 0.5f;
+                positions.push_back(position);
+            }
+        }
+
+        EvaluationWeights start{0, 1, 0, 5, 0, 0, 0, 0, 0, 0, 0};
+        Tuner singleThreaded(positions, 1);
+        Tuner tuner(positions, 4);
+        expect(std::abs(singleThreaded.loss(start) - tuner.loss(start)) < 1e-9);
+
+        tuner.fitScale(start);
+        const double before = tuner.loss(start);
+        auto tuned = tuner.tune(start, 300, 0.1);
+        expect(tuner.loss(tuned) < before);
+        expect(tuned[1] > 1.0);
+        expect(std::abs(tuned[3]) < 5.0);
+    };
+}